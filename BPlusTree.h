@@ -0,0 +1,848 @@
+// B+ tree index of the pending rides by ride number (see RideIndex.h), selected with --index btree.
+// Nodes hold 32 keys in two cache lines, aligned to a line boundary, and are searched by
+// comparing all 32 keys at once with SSE2 (a plain loop elsewhere, which compilers vectorize),
+// so a lookup takes one or two misses per level over a tree a quarter as deep as the Red-Black
+// Tree. Unused key slots hold INT_MAX, which lets the search run over the whole node without
+// looking at the count. Leaves are linked, so Print(r1,r2) is a walk along the leaf chain.
+// Rides stay in RBTNode records from the node arena, which the priority queue refers to; leaves
+// map ride numbers to those records. An insert at the right end of the tree splits a full node
+// into a nearly full one and a new one, so ascending ride numbers pack nodes almost completely.
+// Inner nodes also count the rides under each child, which gives rank and select in O(log n).
+// A ride number past the end of the tail leaf goes straight down the right spine without
+// comparing keys, and the fused operations remove or insert at the slot their one descent found.
+
+#ifndef GATORTAXI_BPLUSTREE_H
+#define GATORTAXI_BPLUSTREE_H
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "OutputWriter.h"
+#include "RBTNode.h"
+#include "RBTNodeArena.h"
+#include "RideIndex.h"
+#include "RideQueue.h"
+#include "Stats.h"
+
+class BPlusTree final : public RideIndex
+{
+public:
+    static const int SLOTS = 32;
+    static const std::size_t BATCH_REBUILD_FRACTION = 16;
+
+    BPlusTree(std::size_t heapReserve = 100, QueueKind queueKind = QUEUE_BINARY, bool rideNumberTies = false) : RideIndex(heapReserve, queueKind, rideNumberTies), depth(0)
+    {
+        root = tail = newLeaf();
+    }
+
+    ~BPlusTree()
+    {
+        // The arena frees all records in bulk, only per-node allocation needs them released
+        if (!RBTNodeArena::bulkRelease)
+        {
+            for (Leaf *leaf = findLeaf(INT_MIN); leaf; leaf = leaf->next)
+            {
+                for (int i = 0; i < leaf->count; ++i)
+                {
+                    records.release(leaf->records[i]);
+                }
+            }
+        }
+        freeNodes(root);
+    }
+
+    using RideIndex::printRange;
+
+    void insert(Ride ride) override
+    {
+        RBTNode *record = records.allocate(ride, BLACK);
+        insertRecord(record);
+        hashInsert(record);
+        minHeap->insert(record);
+    }
+
+    bool tryInsert(Ride ride) override
+    {
+        int rightSpine;
+        Leaf *leaf = descend(ride.rideNumber, rightSpine);
+        int pos = countLess(leaf->keys, ride.rideNumber);
+        if (pos < leaf->count && leaf->keys[pos] == ride.rideNumber)
+        {
+            return false;
+        }
+        RBTNode *record = records.allocate(ride, BLACK);
+        insertAt(leaf, pos, record, rightSpine);
+        hashInsert(record);
+        minHeap->insert(record);
+        return true;
+    }
+
+    // removeNode finds the leaf by descending again, so a cancel is done from the lookup's descent
+    bool updateTrip(int rideNumber, int newTripDuration) override
+    {
+        // The hash index finds the ride without a descent, and most updates need none after it
+        if (hashIndex.isEnabled())
+        {
+            return RideIndex::updateTrip(rideNumber, newTripDuration);
+        }
+        Leaf *leaf;
+        int pos;
+        if (!descendTo(rideNumber, leaf, pos))
+        {
+            return false;
+        }
+        if (!updateRide(leaf->records[pos], newTripDuration))
+        {
+            eraseRecordAt(leaf, pos);
+        }
+        return true;
+    }
+
+    bool cancelRide(int rideNumber) override
+    {
+        if (hashIndex.isEnabled() && !hashIndex.find(rideNumber))
+        {
+            return false;
+        }
+        Leaf *leaf;
+        int pos;
+        if (!descendTo(rideNumber, leaf, pos))
+        {
+            return false;
+        }
+        eraseRecordAt(leaf, pos);
+        return true;
+    }
+
+    RBTNode *search(int rideNumber) override
+    {
+        if (hashIndex.isEnabled())
+        {
+            return hashIndex.find(rideNumber);
+        }
+        Leaf *leaf = findLeaf(rideNumber);
+        int pos = countLess(leaf->keys, rideNumber);
+        return pos < leaf->count && leaf->keys[pos] == rideNumber ? leaf->records[pos] : nullptr;
+    }
+
+    void printRange(int rideNumber1, int rideNumber2, OutputWriter &outputFile) override
+    {
+        Leaf *leaf = findLeaf(rideNumber1);
+        int pos = countLess(leaf->keys, rideNumber1);
+        bool any = false;
+        bool done = false;
+        while (leaf && !done)
+        {
+            if (leaf->next)
+                __builtin_prefetch(leaf->next);
+            for (; pos < leaf->count; ++pos)
+            {
+                if (leaf->keys[pos] > rideNumber2)
+                {
+                    done = true;
+                    break;
+                }
+                if (any)
+                    outputFile.put(',');
+                outputFile.writeRide(leaf->records[pos]->ride);
+                any = true;
+            }
+            leaf = leaf->next;
+            pos = 0;
+        }
+        if (!any)
+        {
+            outputFile.write("(0,0,0)");
+        }
+    }
+
+    void removeNode(RBTNode *record) override
+    {
+        minHeap->remove(record);
+        hashErase(record->ride.rideNumber);
+        eraseKey(record->ride.rideNumber);
+        records.release(record);
+    }
+
+    // Batches are erased in ride number order, so consecutive erases walk down the same path; a
+    // batch of at least size() / BATCH_REBUILD_FRACTION rides instead rebuilds the tree from the
+    // remaining records, which ascending appends pack into nearly full nodes
+    void removeExtracted(std::vector<RBTNode *> &extracted) override
+    {
+        if (extracted.size() < size() / BATCH_REBUILD_FRACTION)
+        {
+            std::sort(extracted.begin(), extracted.end(), [](const RBTNode *a, const RBTNode *b) { return a->ride.rideNumber < b->ride.rideNumber; });
+            for (RBTNode *record : extracted)
+            {
+                hashErase(record->ride.rideNumber);
+                eraseKey(record->ride.rideNumber);
+                records.release(record);
+            }
+            return;
+        }
+
+        // Extracted rides are the ones no longer in the heap
+        std::vector<RBTNode *> kept;
+        kept.reserve(size() - extracted.size());
+        for (Leaf *leaf = findLeaf(INT_MIN); leaf; leaf = leaf->next)
+        {
+            for (int i = 0; i < leaf->count; ++i)
+            {
+                if (minHeap->contains(leaf->records[i]))
+                    kept.push_back(leaf->records[i]);
+            }
+        }
+        for (RBTNode *record : extracted)
+        {
+            hashErase(record->ride.rideNumber);
+            records.release(record);
+        }
+        freeNodes(root);
+        root = tail = newLeaf();
+        depth = 0;
+        for (RBTNode *record : kept)
+        {
+            insertRecord(record);
+        }
+    }
+
+    // Rides are appended one by one down the right spine, which stays in cache, and heapified
+    // together; each append is O(log n) but only touches full, freshly written nodes
+    bool appendSorted(const Ride *rides, std::size_t count) override
+    {
+        if (count == 0)
+        {
+            return true;
+        }
+        if (tail->count && tail->keys[tail->count - 1] >= rides[0].rideNumber)
+        {
+            return false;
+        }
+
+        std::vector<RBTNode *> added;
+        added.reserve(count);
+        for (const Ride *ride = rides; ride != rides + count; ++ride)
+        {
+            RBTNode *record = records.allocate(*ride, BLACK);
+            insertRecord(record);
+            hashInsert(record);
+            added.push_back(record);
+        }
+        minHeap->insertAll(added);
+        return true;
+    }
+
+    using RideIndex::appendSorted;
+
+    void collectSorted(std::vector<Ride> &out) override
+    {
+        for (Leaf *leaf = findLeaf(INT_MIN); leaf; leaf = leaf->next)
+        {
+            for (int pos = 0; pos < leaf->count; ++pos)
+            {
+                out.push_back(leaf->records[pos]->ride);
+            }
+        }
+    }
+
+    void collectNodes(std::vector<RBTNode *> &out) override
+    {
+        for (Leaf *leaf = findLeaf(INT_MIN); leaf; leaf = leaf->next)
+        {
+            out.insert(out.end(), leaf->records, leaf->records + leaf->count);
+        }
+    }
+
+    std::size_t size() const override { return records.size(); }
+
+    std::size_t rank(int rideNumber) override
+    {
+        std::size_t smaller = 0;
+        Node *node = root;
+        while (!node->leaf)
+        {
+            const Inner *inner = static_cast<const Inner *>(node);
+            int i = childIndex(inner, rideNumber);
+            for (int j = 0; j < i; ++j)
+            {
+                smaller += inner->counts[j];
+            }
+            node = inner->children[i];
+        }
+        return smaller + countLess(node->keys, rideNumber);
+    }
+
+    RBTNode *select(std::size_t index) override
+    {
+        int pos;
+        Leaf *leaf = locate(index, pos);
+        return leaf ? leaf->records[pos] : nullptr;
+    }
+
+    void printPage(int rideNumber1, int rideNumber2, std::size_t offset, std::size_t limit, OutputWriter &outputFile) override
+    {
+        int pos = 0;
+        Leaf *leaf = limit ? locate(rank(rideNumber1) + offset, pos) : nullptr;
+        bool any = false;
+        for (; leaf && limit; leaf = leaf->next, pos = 0)
+        {
+            for (; pos < leaf->count && limit; ++pos, --limit)
+            {
+                if (leaf->keys[pos] > rideNumber2)
+                {
+                    limit = 0;
+                    break;
+                }
+                if (any)
+                    outputFile.put(',');
+                outputFile.writeRide(leaf->records[pos]->ride);
+                any = true;
+            }
+        }
+        if (!any)
+        {
+            outputFile.write("(0,0,0)");
+        }
+    }
+
+    int height() const override { return depth + 1; }
+
+private:
+    static const int LEAF_MIN = SLOTS / 2;
+    static const int INNER_KEYS = SLOTS - 1; // an inner node has up to SLOTS children
+    static const int INNER_MIN = SLOTS / 2 - 1;
+    // Inner levels above the leaves: every inner node but the root has at least 16 children, so
+    // even 2^31 rides need fewer than 8
+    static const int MAX_DEPTH = 10;
+
+    struct alignas(64) Node
+    {
+        int keys[SLOTS]; // ascending; slots past count hold INT_MAX
+        int count;
+        bool leaf;
+    };
+
+    struct Leaf : Node
+    {
+        RBTNode *records[SLOTS];
+        Leaf *next;
+    };
+
+    // keys[i] is the smallest ride number under children[i + 1], counts[i] the rides under children[i]
+    struct Inner : Node
+    {
+        Node *children[SLOTS];
+        int counts[SLOTS];
+    };
+
+    Node *root;
+    Leaf *tail; // rightmost leaf, holds the largest ride number
+    int depth;  // inner levels above the leaves
+    RBTNodeArena records;
+    // Root-to-leaf path of the current insert or erase: inner nodes and the child taken in each
+    Inner *pathNodes[MAX_DEPTH];
+    int pathSlots[MAX_DEPTH];
+    int pathLength;
+
+    template <typename T>
+    static T *allocateNode()
+    {
+        void *memory = nullptr;
+        if (posix_memalign(&memory, 64, sizeof(T)) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        T *node = new (memory) T();
+        for (int i = 0; i < SLOTS; ++i)
+        {
+            node->keys[i] = INT_MAX;
+        }
+        node->count = 0;
+        return node;
+    }
+
+    static Leaf *newLeaf()
+    {
+        Leaf *leaf = allocateNode<Leaf>();
+        leaf->leaf = true;
+        leaf->next = nullptr;
+        return leaf;
+    }
+
+    static Inner *newInner()
+    {
+        Inner *inner = allocateNode<Inner>();
+        inner->leaf = false;
+        return inner;
+    }
+
+    // Number of keys in the node smaller than key, i.e. the position of key among them
+    static int countLess(const int *keys, int key)
+    {
+#if defined(__SSE2__)
+        __m128i target = _mm_set1_epi32(key);
+        __m128i total = _mm_setzero_si128();
+        for (int i = 0; i < SLOTS; i += 4)
+        {
+            __m128i block = _mm_load_si128(reinterpret_cast<const __m128i *>(keys + i));
+            // Lanes where the key is smaller are -1, subtracting them counts them
+            total = _mm_sub_epi32(total, _mm_cmplt_epi32(block, target));
+        }
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(1, 0, 3, 2)));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(total);
+#else
+        int smaller = 0;
+        for (int i = 0; i < SLOTS; ++i)
+        {
+            smaller += keys[i] < key;
+        }
+        return smaller;
+#endif
+    }
+
+    // Child of an inner node whose range holds key: the number of separators <= key
+    static int childIndex(const Inner *inner, int key) { return key == INT_MAX ? inner->count : countLess(inner->keys, key + 1); }
+
+    // Frees the nodes of the subtree, but not the records in its leaves
+    static void freeNodes(Node *top)
+    {
+        std::vector<Node *> pending(1, top);
+        while (!pending.empty())
+        {
+            Node *node = pending.back();
+            pending.pop_back();
+            if (!node->leaf)
+            {
+                Inner *inner = static_cast<Inner *>(node);
+                pending.insert(pending.end(), inner->children, inner->children + inner->count + 1);
+            }
+            std::free(node);
+        }
+    }
+
+    // Leaf and slot of the ride at 0-based position index, nullptr past the end
+    Leaf *locate(std::size_t index, int &pos) const
+    {
+        if (index >= records.size())
+        {
+            return nullptr;
+        }
+        Node *node = root;
+        while (!node->leaf)
+        {
+            const Inner *inner = static_cast<const Inner *>(node);
+            int i = 0;
+            while (index >= static_cast<std::size_t>(inner->counts[i]))
+            {
+                index -= inner->counts[i++];
+            }
+            node = inner->children[i];
+        }
+        pos = static_cast<int>(index);
+        return static_cast<Leaf *>(node);
+    }
+
+    static int subtreeSize(const Node *node)
+    {
+        if (node->leaf)
+        {
+            return node->count;
+        }
+        const Inner *inner = static_cast<const Inner *>(node);
+        int total = 0;
+        for (int i = 0; i <= inner->count; ++i)
+        {
+            total += inner->counts[i];
+        }
+        return total;
+    }
+
+    static void recount(Inner *inner, int i) { inner->counts[i] = subtreeSize(inner->children[i]); }
+
+    static void recountAll(Inner *inner)
+    {
+        for (int i = 0; i <= inner->count; ++i)
+        {
+            recount(inner, i);
+        }
+    }
+
+    Leaf *findLeaf(int key) const
+    {
+        Node *node = root;
+        while (!node->leaf)
+        {
+            const Inner *inner = static_cast<const Inner *>(node);
+            // Start loading the child pointers while the keys are compared
+            for (int line = 0; line < static_cast<int>(sizeof(inner->children)); line += 64)
+                __builtin_prefetch(reinterpret_cast<const char *>(inner->children) + line);
+            node = inner->children[childIndex(inner, key)];
+        }
+        return static_cast<Leaf *>(node);
+    }
+
+    // Descends to key's leaf recording the path; returns how many of the top levels were entered
+    // through their last child, so the path is on the right spine of the tree down to that level
+    Leaf *descend(int key, int &rightSpine)
+    {
+        pathLength = 0;
+        Node *node = root;
+        // Past the largest ride number every level is entered through its last child
+        if (tail->count && key > tail->keys[tail->count - 1])
+        {
+            while (!node->leaf)
+            {
+                Inner *inner = static_cast<Inner *>(node);
+                pathNodes[pathLength] = inner;
+                pathSlots[pathLength++] = inner->count;
+                node = inner->children[inner->count];
+            }
+            rightSpine = pathLength;
+            return static_cast<Leaf *>(node);
+        }
+        rightSpine = -1;
+        while (!node->leaf)
+        {
+            Inner *inner = static_cast<Inner *>(node);
+            for (int line = 0; line < static_cast<int>(sizeof(inner->children)); line += 64)
+                __builtin_prefetch(reinterpret_cast<const char *>(inner->children) + line);
+            int i = childIndex(inner, key);
+            if (rightSpine < 0 && i != inner->count)
+                rightSpine = pathLength;
+            pathNodes[pathLength] = inner;
+            pathSlots[pathLength++] = i;
+            node = inner->children[i];
+        }
+        if (rightSpine < 0)
+            rightSpine = pathLength;
+        return static_cast<Leaf *>(node);
+    }
+
+    static void leafInsertAt(Leaf *leaf, int pos, int key, RBTNode *record)
+    {
+        int moved = leaf->count - pos;
+        std::memmove(leaf->keys + pos + 1, leaf->keys + pos, moved * sizeof(int));
+        std::memmove(leaf->records + pos + 1, leaf->records + pos, moved * sizeof(RBTNode *));
+        leaf->keys[pos] = key;
+        leaf->records[pos] = record;
+        ++leaf->count;
+    }
+
+    static void leafEraseAt(Leaf *leaf, int pos)
+    {
+        int moved = leaf->count - pos - 1;
+        std::memmove(leaf->keys + pos, leaf->keys + pos + 1, moved * sizeof(int));
+        std::memmove(leaf->records + pos, leaf->records + pos + 1, moved * sizeof(RBTNode *));
+        leaf->keys[--leaf->count] = INT_MAX;
+    }
+
+    // Moves the entries from start on to the end of the leaf to
+    static void leafMoveTail(Leaf *from, int start, Leaf *to)
+    {
+        int moved = from->count - start;
+        std::memcpy(to->keys + to->count, from->keys + start, moved * sizeof(int));
+        std::memcpy(to->records + to->count, from->records + start, moved * sizeof(RBTNode *));
+        to->count += moved;
+        for (int i = start; i < from->count; ++i)
+        {
+            from->keys[i] = INT_MAX;
+        }
+        from->count = start;
+    }
+
+    // Puts separator key at keys[i] and its right-hand child at children[i + 1]
+    static void innerInsertAt(Inner *inner, int i, int key, Node *child)
+    {
+        int moved = inner->count - i;
+        std::memmove(inner->keys + i + 1, inner->keys + i, moved * sizeof(int));
+        std::memmove(inner->children + i + 2, inner->children + i + 1, moved * sizeof(Node *));
+        std::memmove(inner->counts + i + 2, inner->counts + i + 1, moved * sizeof(int));
+        inner->keys[i] = key;
+        inner->children[i + 1] = child;
+        ++inner->count;
+        recount(inner, i);
+        recount(inner, i + 1);
+    }
+
+    // Drops keys[i] and children[i + 1], and recounts the merged children[i]
+    static void innerEraseAt(Inner *inner, int i)
+    {
+        int moved = inner->count - i - 1;
+        std::memmove(inner->keys + i, inner->keys + i + 1, moved * sizeof(int));
+        std::memmove(inner->children + i + 1, inner->children + i + 2, moved * sizeof(Node *));
+        std::memmove(inner->counts + i + 1, inner->counts + i + 2, moved * sizeof(int));
+        inner->keys[--inner->count] = INT_MAX;
+        recount(inner, i);
+    }
+
+    // Descends to the ride number's leaf; returns false if it is not there, otherwise its slot
+    bool descendTo(int rideNumber, Leaf *&leaf, int &pos)
+    {
+        int rightSpine;
+        leaf = descend(rideNumber, rightSpine);
+        pos = countLess(leaf->keys, rideNumber);
+        return pos < leaf->count && leaf->keys[pos] == rideNumber;
+    }
+
+    // Takes the record at the slot descendTo found out of the heap and the tree and frees it
+    void eraseRecordAt(Leaf *leaf, int pos)
+    {
+        RBTNode *record = leaf->records[pos];
+        minHeap->remove(record);
+        hashErase(record->ride.rideNumber);
+        eraseAt(leaf, pos);
+        records.release(record);
+    }
+
+    void insertRecord(RBTNode *record)
+    {
+        int rightSpine;
+        Leaf *leaf = descend(record->ride.rideNumber, rightSpine);
+        insertAt(leaf, countLess(leaf->keys, record->ride.rideNumber), record, rightSpine);
+    }
+
+    // Puts the record at slot pos of the leaf the last descend reached, splitting up the path
+    void insertAt(Leaf *leaf, int pos, RBTNode *record, int rightSpine)
+    {
+        int key = record->ride.rideNumber;
+        // Splits below recount the slots they change; every other count on the path just grows
+        for (int level = 0; level < pathLength; ++level)
+        {
+            ++pathNodes[level]->counts[pathSlots[level]];
+        }
+        if (leaf->count < SLOTS)
+        {
+            leafInsertAt(leaf, pos, key, record);
+            return;
+        }
+
+        // Split the SLOTS + 1 entries; an append at the right end leaves the new leaf just two, so
+        // every node keeps a sibling to borrow from or merge with
+        bool append = rightSpine == pathLength && pos == leaf->count;
+        int keep = append ? SLOTS - 1 : (SLOTS + 1) / 2;
+        Leaf *right = newLeaf();
+        if (pos < keep)
+        {
+            leafMoveTail(leaf, keep - 1, right);
+            leafInsertAt(leaf, pos, key, record);
+        }
+        else
+        {
+            leafMoveTail(leaf, keep, right);
+            leafInsertAt(right, pos - keep, key, record);
+        }
+        right->next = leaf->next;
+        if (!right->next)
+            tail = right;
+        leaf->next = right;
+        GATORTAXI_STAT(++insertRotations;)
+
+        int separator = right->keys[0];
+        Node *child = right;
+        for (int level = pathLength - 1; level >= 0; --level)
+        {
+            Inner *parent = pathNodes[level];
+            int i = pathSlots[level];
+            if (parent->count < INNER_KEYS)
+            {
+                innerInsertAt(parent, i, separator, child);
+                return;
+            }
+
+            // Split the SLOTS separators and SLOTS + 1 children; the middle separator moves up
+            int keys[SLOTS];
+            Node *children[SLOTS + 1];
+            std::memcpy(keys, parent->keys, i * sizeof(int));
+            keys[i] = separator;
+            std::memcpy(keys + i + 1, parent->keys + i, (INNER_KEYS - i) * sizeof(int));
+            std::memcpy(children, parent->children, (i + 1) * sizeof(Node *));
+            children[i + 1] = child;
+            std::memcpy(children + i + 2, parent->children + i + 1, (INNER_KEYS - i) * sizeof(Node *));
+
+            bool appendInner = level < rightSpine && i == parent->count;
+            int leftKeys = appendInner ? INNER_KEYS - 1 : SLOTS / 2;
+            Inner *sibling = newInner();
+            for (int k = 0; k < SLOTS; ++k)
+            {
+                parent->keys[k] = k < leftKeys ? keys[k] : INT_MAX;
+            }
+            std::memcpy(parent->children, children, (leftKeys + 1) * sizeof(Node *));
+            parent->count = leftKeys;
+            sibling->count = SLOTS - leftKeys - 1;
+            std::memcpy(sibling->keys, keys + leftKeys + 1, sibling->count * sizeof(int));
+            std::memcpy(sibling->children, children + leftKeys + 1, (sibling->count + 1) * sizeof(Node *));
+            recountAll(parent);
+            recountAll(sibling);
+            GATORTAXI_STAT(++insertRotations;)
+
+            separator = keys[leftKeys];
+            child = sibling;
+        }
+
+        // The root split, the tree grows a level
+        Inner *newRoot = newInner();
+        newRoot->count = 1;
+        newRoot->keys[0] = separator;
+        newRoot->children[0] = root;
+        newRoot->children[1] = child;
+        recountAll(newRoot);
+        root = newRoot;
+        ++depth;
+    }
+
+    void eraseKey(int key)
+    {
+        int rightSpine;
+        Leaf *leaf = descend(key, rightSpine);
+        eraseAt(leaf, countLess(leaf->keys, key));
+    }
+
+    // Drops slot pos of the leaf the last descend reached, rebalancing up the path
+    void eraseAt(Leaf *leaf, int pos)
+    {
+        leafEraseAt(leaf, pos);
+        for (int level = 0; level < pathLength; ++level)
+        {
+            --pathNodes[level]->counts[pathSlots[level]];
+        }
+
+        Node *node = leaf;
+        for (int level = pathLength - 1; level >= 0; --level)
+        {
+            if (node->count >= (node->leaf ? LEAF_MIN : INNER_MIN))
+            {
+                break;
+            }
+            if (node->leaf)
+                rebalanceLeaf(pathNodes[level], pathSlots[level]);
+            else
+                rebalanceInner(pathNodes[level], pathSlots[level]);
+            GATORTAXI_STAT(++removeRotations;)
+            node = pathNodes[level];
+        }
+
+        // A root left with a single child hands the tree down to it
+        if (!root->leaf && root->count == 0)
+        {
+            Node *oldRoot = root;
+            root = static_cast<Inner *>(root)->children[0];
+            std::free(oldRoot);
+            --depth;
+        }
+    }
+
+    // Refills the underfull leaf children[i] from a sibling, or merges it with one
+    void rebalanceLeaf(Inner *parent, int i)
+    {
+        Leaf *leaf = static_cast<Leaf *>(parent->children[i]);
+        Leaf *left = i > 0 ? static_cast<Leaf *>(parent->children[i - 1]) : nullptr;
+        Leaf *right = i < parent->count ? static_cast<Leaf *>(parent->children[i + 1]) : nullptr;
+
+        if (left && left->count > LEAF_MIN)
+        {
+            leafInsertAt(leaf, 0, left->keys[left->count - 1], left->records[left->count - 1]);
+            leafEraseAt(left, left->count - 1);
+            parent->keys[i - 1] = leaf->keys[0];
+            recount(parent, i - 1);
+            recount(parent, i);
+        }
+        else if (right && right->count > LEAF_MIN)
+        {
+            leafInsertAt(leaf, leaf->count, right->keys[0], right->records[0]);
+            leafEraseAt(right, 0);
+            parent->keys[i] = right->keys[0];
+            recount(parent, i);
+            recount(parent, i + 1);
+        }
+        else if (left)
+        {
+            mergeLeaves(left, leaf);
+            innerEraseAt(parent, i - 1);
+        }
+        else
+        {
+            mergeLeaves(leaf, right);
+            innerEraseAt(parent, i);
+        }
+    }
+
+    // Moves everything in right into left and frees right
+    void mergeLeaves(Leaf *left, Leaf *right)
+    {
+        leafMoveTail(right, 0, left);
+        left->next = right->next;
+        if (!left->next)
+            tail = left;
+        std::free(right);
+    }
+
+    // Refills the underfull inner node children[i] through the parent separator, or merges it
+    void rebalanceInner(Inner *parent, int i)
+    {
+        Inner *node = static_cast<Inner *>(parent->children[i]);
+        Inner *left = i > 0 ? static_cast<Inner *>(parent->children[i - 1]) : nullptr;
+        Inner *right = i < parent->count ? static_cast<Inner *>(parent->children[i + 1]) : nullptr;
+
+        if (left && left->count > INNER_MIN)
+        {
+            std::memmove(node->keys + 1, node->keys, node->count * sizeof(int));
+            std::memmove(node->children + 1, node->children, (node->count + 1) * sizeof(Node *));
+            std::memmove(node->counts + 1, node->counts, (node->count + 1) * sizeof(int));
+            node->keys[0] = parent->keys[i - 1];
+            node->children[0] = left->children[left->count];
+            node->counts[0] = left->counts[left->count];
+            ++node->count;
+            parent->keys[i - 1] = left->keys[left->count - 1];
+            left->keys[--left->count] = INT_MAX;
+            recount(parent, i - 1);
+            recount(parent, i);
+        }
+        else if (right && right->count > INNER_MIN)
+        {
+            node->keys[node->count] = parent->keys[i];
+            node->children[node->count + 1] = right->children[0];
+            node->counts[node->count + 1] = right->counts[0];
+            ++node->count;
+            parent->keys[i] = right->keys[0];
+            std::memmove(right->keys, right->keys + 1, (right->count - 1) * sizeof(int));
+            std::memmove(right->children, right->children + 1, right->count * sizeof(Node *));
+            std::memmove(right->counts, right->counts + 1, right->count * sizeof(int));
+            right->keys[--right->count] = INT_MAX;
+            recount(parent, i);
+            recount(parent, i + 1);
+        }
+        else if (left)
+        {
+            mergeInner(left, parent->keys[i - 1], node);
+            innerEraseAt(parent, i - 1);
+        }
+        else
+        {
+            mergeInner(node, parent->keys[i], right);
+            innerEraseAt(parent, i);
+        }
+    }
+
+    // Appends the separator and everything in right to left and frees right
+    static void mergeInner(Inner *left, int separator, Inner *right)
+    {
+        left->keys[left->count] = separator;
+        std::memcpy(left->keys + left->count + 1, right->keys, right->count * sizeof(int));
+        std::memcpy(left->children + left->count + 1, right->children, (right->count + 1) * sizeof(Node *));
+        std::memcpy(left->counts + left->count + 1, right->counts, (right->count + 1) * sizeof(int));
+        left->count += right->count + 1;
+        std::free(right);
+    }
+};
+
+#endif
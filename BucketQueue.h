@@ -0,0 +1,370 @@
+// Bucket queue backend for the pending rides (see RideQueue.h).
+// Ride costs are small integers, so rides are filed into one bucket per cost and only rides of
+// equal cost are ever compared; a two-level occupancy bitmap finds the cheapest non-empty
+// bucket in two bit scans. Each bucket is a small binary heap on (duration, ride number).
+// Costs outside 0..COST_BUCKETS-1 go into one overflow heap ordered by the full key, which is
+// checked against the cheapest bucket, so any cost still works.
+// Entries live in one array; RBTNode::heapIndex is the node's entry.
+
+#ifndef GATORTAXI_BUCKETQUEUE_H
+#define GATORTAXI_BUCKETQUEUE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "RBTNode.h"
+#include "RideQueue.h"
+
+class BucketQueue final : public RideQueue
+{
+public:
+    static const int COST_BUCKETS = 4095;
+
+private:
+    static const int OVERFLOW_BUCKET = COST_BUCKETS;
+    static const int WORDS = (COST_BUCKETS + 1) / 64;
+
+    struct Entry
+    {
+        Ride key;
+        RBTNode *node;
+        int bucket;
+        int pos; // slot inside the bucket's heap
+    };
+
+    std::vector<Entry> entries;
+    std::vector<int> freeEntries;
+    std::vector<std::vector<int> > buckets;
+    std::uint64_t occupied[WORDS];
+    std::uint64_t occupiedWords; // bit w set when occupied[w] != 0
+    int size;
+    std::size_t initialCapacity;
+
+    static int bucketOf(const Ride &ride) { return ride.rideCost >= 0 && ride.rideCost < COST_BUCKETS ? ride.rideCost : OVERFLOW_BUCKET; }
+
+    bool less(int a, int b) const { return entries[a].key.compareTotal(entries[b].key) < 0; }
+
+    void mark(int bucket)
+    {
+        occupied[bucket >> 6] |= std::uint64_t(1) << (bucket & 63);
+        occupiedWords |= std::uint64_t(1) << (bucket >> 6);
+    }
+
+    void unmark(int bucket)
+    {
+        occupied[bucket >> 6] &= ~(std::uint64_t(1) << (bucket & 63));
+        if (!occupied[bucket >> 6])
+            occupiedWords &= ~(std::uint64_t(1) << (bucket >> 6));
+    }
+
+    // First occupied bucket from the given one on, or past OVERFLOW_BUCKET if there is none
+    int firstOccupied(int from) const
+    {
+        int word = from >> 6;
+        if (word >= WORDS)
+        {
+            return OVERFLOW_BUCKET + 1;
+        }
+        std::uint64_t bits = occupied[word] & (~std::uint64_t(0) << (from & 63));
+        if (bits)
+        {
+            return (word << 6) + __builtin_ctzll(bits);
+        }
+        std::uint64_t words = word + 1 < WORDS ? occupiedWords & (~std::uint64_t(0) << (word + 1)) : 0;
+        if (!words)
+        {
+            return OVERFLOW_BUCKET + 1;
+        }
+        word = __builtin_ctzll(words);
+        return (word << 6) + __builtin_ctzll(occupied[word]);
+    }
+
+    // Entry with the smallest key: the head of the cheapest bucket, unless the overflow beats it
+    int minEntry() const
+    {
+        int word = __builtin_ctzll(occupiedWords);
+        int bucket = (word << 6) + __builtin_ctzll(occupied[word]);
+        int best = buckets[bucket][0];
+        if (bucket != OVERFLOW_BUCKET && !buckets[OVERFLOW_BUCKET].empty() && less(buckets[OVERFLOW_BUCKET][0], best))
+        {
+            best = buckets[OVERFLOW_BUCKET][0];
+        }
+        return best;
+    }
+
+    void place(std::vector<int> &heap, int pos, int e)
+    {
+        heap[pos] = e;
+        entries[e].pos = pos;
+    }
+
+    void siftUp(std::vector<int> &heap, int pos);
+    void siftDown(std::vector<int> &heap, int pos);
+    void push(int e);
+    void erase(int e);
+    int acquire(RBTNode *node);
+    void release(int e);
+
+public:
+    BucketQueue(std::size_t initialCapacity) : buckets(COST_BUCKETS + 1), occupiedWords(0), size(0), initialCapacity(initialCapacity)
+    {
+        for (int w = 0; w < WORDS; ++w)
+        {
+            occupied[w] = 0;
+        }
+        entries.reserve(initialCapacity);
+    }
+
+    bool isEmpty() const override { return size == 0; }
+    int getSize() const override { return size; }
+    std::size_t getCapacity() const override { return entries.capacity(); }
+    RBTNode *getMin() const override { return entries[minEntry()].node; }
+    void insert(RBTNode *node) override;
+    void insertAll(const std::vector<RBTNode *> &nodes) override;
+    RBTNode *extractMin() override;
+    void remove(RBTNode *node) override;
+    void update(RBTNode *node) override;
+    void peekSmallest(std::size_t k, std::vector<RBTNode *> &out) const override;
+};
+
+// siftUp function for one bucket of the Bucket Queue
+inline void BucketQueue::siftUp(std::vector<int> &heap, int pos)
+{
+    int e = heap[pos];
+    while (pos > 0)
+    {
+        int parent = (pos - 1) / 2;
+        if (!less(e, heap[parent]))
+        {
+            break;
+        }
+        place(heap, pos, heap[parent]);
+        pos = parent;
+    }
+    place(heap, pos, e);
+}
+
+// siftDown function for one bucket of the Bucket Queue
+inline void BucketQueue::siftDown(std::vector<int> &heap, int pos)
+{
+    int count = static_cast<int>(heap.size());
+    int e = heap[pos];
+    while (true)
+    {
+        int child = 2 * pos + 1;
+        if (child >= count)
+        {
+            break;
+        }
+        if (child + 1 < count && less(heap[child + 1], heap[child]))
+        {
+            ++child;
+        }
+        if (!less(heap[child], e))
+        {
+            break;
+        }
+        place(heap, pos, heap[child]);
+        pos = child;
+    }
+    place(heap, pos, e);
+}
+
+// push function for the Bucket Queue, files an entry under its key's bucket
+inline void BucketQueue::push(int e)
+{
+    int bucket = bucketOf(entries[e].key);
+    std::vector<int> &heap = buckets[bucket];
+    entries[e].bucket = bucket;
+    heap.push_back(e);
+    siftUp(heap, static_cast<int>(heap.size()) - 1);
+    if (heap.size() == 1)
+    {
+        mark(bucket);
+    }
+}
+
+// erase function for the Bucket Queue, takes an entry out of its bucket
+inline void BucketQueue::erase(int e)
+{
+    int bucket = entries[e].bucket;
+    std::vector<int> &heap = buckets[bucket];
+    int pos = entries[e].pos;
+    int last = heap.back();
+    heap.pop_back();
+    if (pos < static_cast<int>(heap.size()))
+    {
+        place(heap, pos, last);
+        siftDown(heap, pos);
+        siftUp(heap, entries[last].pos);
+    }
+    if (heap.empty())
+    {
+        unmark(bucket);
+    }
+}
+
+// acquire function for the Bucket Queue, takes a free entry for the node
+inline int BucketQueue::acquire(RBTNode *node)
+{
+    Entry entry = {node->ride, node, -1, -1};
+    int e;
+    if (freeEntries.empty())
+    {
+        e = static_cast<int>(entries.size());
+        entries.push_back(entry);
+    }
+    else
+    {
+        e = freeEntries.back();
+        freeEntries.pop_back();
+        entries[e] = entry;
+    }
+    node->heapIndex = e;
+    return e;
+}
+
+// release function for the Bucket Queue
+// Once the queue runs empty the entry array starts over, giving back what a burst grew it to
+inline void BucketQueue::release(int e)
+{
+    entries[e].node->heapIndex = -1;
+    if (size > 0)
+    {
+        freeEntries.push_back(e);
+        return;
+    }
+    freeEntries.clear();
+    if (entries.capacity() > initialCapacity)
+    {
+        std::vector<Entry> fresh;
+        fresh.reserve(initialCapacity);
+        entries.swap(fresh);
+    }
+    else
+    {
+        entries.clear();
+    }
+}
+
+// insert function for the Bucket Queue
+inline void BucketQueue::insert(RBTNode *node)
+{
+    push(acquire(node));
+    ++size;
+}
+
+// insertAll function for the Bucket Queue, each insert already grows the entries geometrically
+inline void BucketQueue::insertAll(const std::vector<RBTNode *> &nodes)
+{
+    for (RBTNode *node : nodes)
+    {
+        insert(node);
+    }
+}
+
+// extractMin function for the Bucket Queue
+inline RBTNode *BucketQueue::extractMin()
+{
+    if (isEmpty())
+    {
+        throw std::underflow_error("No elements in the heap");
+    }
+
+    int e = minEntry();
+    RBTNode *result = entries[e].node;
+    erase(e);
+    --size;
+    release(e);
+    return result;
+}
+
+// remove function for the Bucket Queue, a no-op if the node is not in the queue
+inline void BucketQueue::remove(RBTNode *node)
+{
+    int e = node->heapIndex;
+    if (e < 0)
+    {
+        return;
+    }
+    erase(e);
+    --size;
+    release(e);
+}
+
+// update function for the Bucket Queue, re-files the entry if its cost moved it to another bucket
+inline void BucketQueue::update(RBTNode *node)
+{
+    int e = node->heapIndex;
+    if (e < 0)
+    {
+        return;
+    }
+
+    if (bucketOf(node->ride) == entries[e].bucket)
+    {
+        entries[e].key = node->ride;
+        std::vector<int> &heap = buckets[entries[e].bucket];
+        siftUp(heap, entries[e].pos);
+        siftDown(heap, entries[e].pos);
+        return;
+    }
+    erase(e);
+    entries[e].key = node->ride;
+    push(e);
+}
+
+// peekSmallest function for the Bucket Queue, O(k log k)
+// Inside a bucket an entry taken hands its two children to the frontier; a bucket head also hands
+// over the head of the next occupied cost bucket, which is dearer than anything before it. The
+// overflow heap starts out in the frontier next to the cheapest bucket.
+inline void BucketQueue::peekSmallest(std::size_t k, std::vector<RBTNode *> &out) const
+{
+    if (size == 0 || k == 0)
+    {
+        return;
+    }
+    std::vector<int> frontier;
+    frontier.reserve(std::min<std::size_t>(k, size) + 2);
+    auto after = [this](int a, int b) { return less(b, a); };
+    int first = firstOccupied(0);
+    if (first < OVERFLOW_BUCKET)
+    {
+        frontier.push_back(buckets[first][0]);
+    }
+    if (!buckets[OVERFLOW_BUCKET].empty())
+    {
+        frontier.push_back(buckets[OVERFLOW_BUCKET][0]);
+        std::push_heap(frontier.begin(), frontier.end(), after);
+    }
+    while (k-- && !frontier.empty())
+    {
+        std::pop_heap(frontier.begin(), frontier.end(), after);
+        int e = frontier.back();
+        frontier.pop_back();
+        out.push_back(entries[e].node);
+
+        int bucket = entries[e].bucket;
+        int pos = entries[e].pos;
+        const std::vector<int> &heap = buckets[bucket];
+        for (int child = 2 * pos + 1; child <= 2 * pos + 2 && child < static_cast<int>(heap.size()); ++child)
+        {
+            frontier.push_back(heap[child]);
+            std::push_heap(frontier.begin(), frontier.end(), after);
+        }
+        if (pos == 0 && bucket != OVERFLOW_BUCKET)
+        {
+            int next = firstOccupied(bucket + 1);
+            if (next < OVERFLOW_BUCKET)
+            {
+                frontier.push_back(buckets[next][0]);
+                std::push_heap(frontier.begin(), frontier.end(), after);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,329 @@
+// Applies parsed commands to the ride store and writes their results.
+// Consecutive Insert commands with ascending ride numbers (a start-of-shift backfill) are held
+// back and applied together: when they all come after the largest ride number in the tree, the
+// batch is bulk-loaded in linear time instead of one insert at a time. The batch is always
+// applied before the next non-Insert command runs, so the output is exactly that of executing
+// the commands one by one, including where a duplicate ride number stops the run.
+// With a write-ahead log attached, every command that changed the pending rides is logged once
+// it has been applied, Inserts as their batch goes in. With a range cache attached, Print(r1,r2)
+// is answered from it where possible, and every changed ride invalidates the entries holding it.
+// GetNextRides(k) writes and logs exactly what k GetNextRide commands would, including one
+// "No active ride requests" line for each ride missing when fewer than k are pending, but takes
+// the rides out of the index as one batch. With a parallel printer attached, wide Print(r1,r2)
+// ranges are formatted on several threads.
+
+#ifndef GATORTAXI_COMMANDEXECUTOR_H
+#define GATORTAXI_COMMANDEXECUTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "CommandParser.h"
+#include "OutputWriter.h"
+#include "ParallelRangePrinter.h"
+#include "RangeCache.h"
+#include "RideIndex.h"
+#include "Stats.h"
+#include "WriteAheadLog.h"
+
+class CommandExecutor
+{
+public:
+    // Smaller runs are cheaper to insert one by one than to build and join a subtree for
+    static const std::size_t BULK_LOAD_THRESHOLD = 64;
+
+    // batchInserts = false applies every Insert as soon as it arrives
+    CommandExecutor(RideIndex &rides, OutputWriter &outputFile, bool batchInserts = true) : rides(rides), outputFile(outputFile), batchInserts(batchInserts), stopped(false) {}
+
+    // Returns false once the run has to stop (a duplicate ride number was inserted)
+    bool execute(const Command &command)
+    {
+        if (stopped)
+        {
+            return false;
+        }
+
+        const int *args = command.args;
+        if (command.type == CMD_INSERT)
+        {
+            // A ride number that does not continue the ascending run starts a new batch
+            if (!pendingInserts.empty() && args[0] <= pendingInserts.back().rideNumber && !flushInserts())
+            {
+                return false;
+            }
+            pendingInserts.push_back(Ride(args[0], args[1], args[2]));
+            return batchInserts || flushInserts();
+        }
+
+        if (!flushInserts())
+        {
+            return false;
+        }
+        if (command.type == CMD_SNAPSHOT)
+        {
+            // Nothing to apply; the caller writes the image now that the held-back Inserts are in
+            return true;
+        }
+
+        GATORTAXI_STAT(StatTimer timer(stats, statKindOf(command.type));)
+        if (command.type == CMD_PRINT)
+        {
+            rides.printRange(args[0], outputFile);
+        }
+        else if (command.type == CMD_PRINT_RANGE)
+        {
+            if (rangeCache)
+            {
+                const std::string *result = rangeCache->find(args[0], args[1]);
+                if (!result)
+                {
+                    printRange(args[0], args[1], rangeCache->startRender());
+                    result = &rangeCache->finishRender(args[0], args[1]);
+                }
+                outputFile.write(result->data(), result->size());
+            }
+            else
+            {
+                printRange(args[0], args[1], outputFile);
+            }
+            outputFile.put('\n');
+        }
+        else if (command.type == CMD_PRINT_PAGE)
+        {
+            rides.printPage(args[0], args[1], args[2], args[3], outputFile);
+            outputFile.put('\n');
+        }
+        else if (command.type == CMD_COUNT)
+        {
+            outputFile.writeInt(static_cast<int>(rides.count(args[0], args[1])));
+            outputFile.put('\n');
+        }
+        else if (command.type == CMD_RANK)
+        {
+            // Rides with a smaller ride number
+            outputFile.writeInt(static_cast<int>(rides.rank(args[0])));
+            outputFile.put('\n');
+        }
+        else if (command.type == CMD_SELECT)
+        {
+            RBTNode *node = args[0] >= 0 ? rides.select(args[0]) : nullptr;
+            if (node)
+                outputFile.writeRide(node->ride);
+            else
+                outputFile.write("(0,0,0)");
+            outputFile.put('\n');
+        }
+        else if (command.type == CMD_PEEK_NEXT_RIDES)
+        {
+            if (rides.minHeap->isEmpty())
+            {
+                outputFile.write("No active ride requests\n");
+            }
+            else
+            {
+                batch.clear();
+                rides.minHeap->peekSmallest(args[0], batch);
+                for (std::size_t i = 0; i < batch.size(); ++i)
+                {
+                    if (i)
+                        outputFile.put(',');
+                    outputFile.writeRide(batch[i]->ride);
+                }
+                outputFile.put('\n');
+            }
+        }
+        else if (command.type == CMD_GET_NEXT_RIDES)
+        {
+            batch.clear();
+            int taken = std::min(args[0], rides.minHeap->getSize());
+            for (int i = 0; i < taken; ++i)
+            {
+                batch.push_back(rides.minHeap->extractMin());
+            }
+            Command single;
+            single.type = CMD_GET_NEXT_RIDE;
+            for (RBTNode *node : batch)
+            {
+                applied(single, node->ride.rideNumber);
+                outputFile.writeRide(node->ride);
+                outputFile.put('\n');
+            }
+            rides.removeExtracted(batch);
+            for (int missing = args[0] - taken; missing > 0; --missing)
+            {
+                outputFile.write("No active ride requests\n");
+            }
+        }
+        else if (command.type == CMD_UPDATE_TRIP)
+        {
+            if (rides.updateTrip(args[0], args[1]))
+            {
+                applied(command, args[0]);
+            }
+        }
+        else if (command.type == CMD_GET_NEXT_RIDE)
+        {
+            if (rides.minHeap->isEmpty())
+            {
+                outputFile.write("No active ride requests\n");
+            }
+            else
+            {
+                RBTNode *nextNode = rides.minHeap->extractMin();
+                Ride nextRide = nextNode->ride;
+                rides.removeNode(nextNode);
+                applied(command, nextRide.rideNumber);
+                outputFile.writeRide(nextRide);
+                outputFile.put('\n');
+            }
+        }
+        else if (command.type == CMD_CANCEL_RIDE)
+        {
+            if (rides.cancelRide(args[0]))
+            {
+                applied(command, args[0]);
+            }
+        }
+        GATORTAXI_STAT(if (stats) stats->observeHeapSize(rides.minHeap->getSize());)
+        return true;
+    }
+
+    // Applied mutations are logged here when set
+    WriteAheadLog *wal = nullptr;
+    // Print(r1,r2) results are cached here when set
+    RangeCache *rangeCache = nullptr;
+    // Wide Print(r1,r2) ranges are formatted in parallel by this when set
+    ParallelRangePrinter *parallelPrinter = nullptr;
+
+#ifdef GATORTAXI_STATS
+    // Latency and heap-size figures are recorded here when set
+    RuntimeStats *stats = nullptr;
+#endif
+
+    // Applies any Inserts still held back; call at end of input and before taking a snapshot
+    bool finish()
+    {
+        return !stopped && flushInserts();
+    }
+
+private:
+    RideIndex &rides;
+    OutputWriter &outputFile;
+    bool batchInserts;
+    std::vector<Ride> pendingInserts;
+    std::vector<RBTNode *> batch; // rides peeked at or taken by the last PeekNextRides/GetNextRides
+    bool stopped;
+
+    void printRange(int rideNumber1, int rideNumber2, OutputWriter &out)
+    {
+        if (parallelPrinter)
+            parallelPrinter->printRange(rides, rideNumber1, rideNumber2, out);
+        else
+            rides.printRange(rideNumber1, rideNumber2, out);
+    }
+
+    // Logs a command that changed the given ride and drops the cached ranges holding it
+    void applied(const Command &command, int rideNumber)
+    {
+        if (wal)
+        {
+            wal->append(command);
+        }
+        if (rangeCache)
+        {
+            rangeCache->invalidate(rideNumber);
+        }
+    }
+
+    bool flushInserts()
+    {
+        if (pendingInserts.empty())
+        {
+            return true;
+        }
+#ifdef GATORTAXI_STATS
+        // A batch is timed as a whole and each of its Inserts is charged an equal share
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::size_t batchSize = pendingInserts.size();
+#endif
+
+        if (pendingInserts.size() >= BULK_LOAD_THRESHOLD && rides.appendSorted(pendingInserts))
+        {
+            if (wal)
+            {
+                for (const Ride &ride : pendingInserts)
+                {
+                    wal->append(CMD_INSERT, ride.rideNumber, ride.rideCost, ride.tripDuration);
+                }
+            }
+            if (rangeCache)
+            {
+                rangeCache->invalidateSorted(pendingInserts.data(), pendingInserts.size());
+            }
+        }
+        else
+        {
+            for (const Ride &ride : pendingInserts)
+            {
+                if (!rides.tryInsert(ride))
+                {
+                    outputFile.write("Duplicate RideNumber");
+                    stopped = true;
+                    break;
+                }
+                if (wal)
+                {
+                    wal->append(CMD_INSERT, ride.rideNumber, ride.rideCost, ride.tripDuration);
+                }
+                if (rangeCache)
+                {
+                    rangeCache->invalidate(ride.rideNumber);
+                }
+            }
+        }
+        pendingInserts.clear();
+#ifdef GATORTAXI_STATS
+        if (stats)
+        {
+            std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            stats->latency[STAT_INSERT].record(ns / batchSize, batchSize);
+            stats->observeHeapSize(rides.minHeap->getSize());
+        }
+#endif
+        return !stopped;
+    }
+
+#ifdef GATORTAXI_STATS
+    static StatKind statKindOf(CommandType type)
+    {
+        switch (type)
+        {
+        case CMD_INSERT:
+            return STAT_INSERT;
+        case CMD_PRINT:
+            return STAT_PRINT;
+        case CMD_PRINT_RANGE:
+        case CMD_PRINT_PAGE:
+            return STAT_PRINT_RANGE;
+        case CMD_UPDATE_TRIP:
+            return STAT_UPDATE_TRIP;
+        case CMD_GET_NEXT_RIDE:
+            return STAT_GET_NEXT_RIDE;
+        case CMD_PEEK_NEXT_RIDES:
+            return STAT_PEEK_NEXT_RIDES;
+        case CMD_GET_NEXT_RIDES:
+            return STAT_GET_NEXT_RIDES;
+        case CMD_COUNT:
+        case CMD_RANK:
+        case CMD_SELECT:
+            return STAT_ORDER_QUERY;
+        default:
+            return STAT_CANCEL_RIDE;
+        }
+    }
+#endif
+};
+
+#endif
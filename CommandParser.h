@@ -0,0 +1,234 @@
+// Command parser for the input stream.
+// Parses one line in place, e.g. "Insert(5,50,120)" or "Print(1,6,20,10)", into a Command without
+// building any strings or streams. Integers are decoded directly from the bytes, and a line
+// that does not match a known command with the right number of arguments is rejected with a
+// message instead of being executed with garbage values.
+
+#ifndef GATORTAXI_COMMANDPARSER_H
+#define GATORTAXI_COMMANDPARSER_H
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+
+enum CommandType
+{
+    CMD_INSERT,
+    CMD_PRINT,
+    CMD_PRINT_RANGE,
+    CMD_UPDATE_TRIP,
+    CMD_GET_NEXT_RIDE,
+    CMD_CANCEL_RIDE,
+    CMD_SNAPSHOT, // written by the caller, see Snapshot.h
+    CMD_COUNT,
+    CMD_PRINT_PAGE,
+    CMD_RANK,
+    CMD_SELECT,
+    CMD_PEEK_NEXT_RIDES,
+    CMD_GET_NEXT_RIDES
+};
+
+class Command
+{
+public:
+    static const int MAX_ARGS = 4;
+
+    CommandType type = CMD_INSERT;
+    int args[MAX_ARGS] = {0, 0, 0, 0};
+    int argCount = 0;
+};
+
+enum ParseResult
+{
+    PARSE_OK,
+    PARSE_EMPTY, // blank line, nothing to execute
+    PARSE_ERROR
+};
+
+class CommandParser
+{
+public:
+    // Parses the line [begin, end); on PARSE_ERROR, error points to a static description
+    static ParseResult parse(const char *begin, const char *end, Command &command, const char *&error)
+    {
+        const char *p = skipSpaces(begin, end);
+        while (end > p && isSpace(end[-1]))
+        {
+            --end;
+        }
+        if (p == end)
+        {
+            return PARSE_EMPTY;
+        }
+
+        const char *nameEnd = p;
+        while (nameEnd < end && *nameEnd != '(' && !isSpace(*nameEnd))
+        {
+            ++nameEnd;
+        }
+
+        const CommandSpec *spec = findSpec(p, nameEnd - p);
+        if (!spec)
+        {
+            error = "unknown command";
+            return PARSE_ERROR;
+        }
+
+        p = skipSpaces(nameEnd, end);
+        if (p == end || *p != '(')
+        {
+            error = "expected '('";
+            return PARSE_ERROR;
+        }
+        p = skipSpaces(p + 1, end);
+
+        int argCount = 0;
+        if (p < end && *p != ')')
+        {
+            while (true)
+            {
+                if (argCount == Command::MAX_ARGS)
+                {
+                    error = "too many arguments";
+                    return PARSE_ERROR;
+                }
+                if (!parseInt(p, end, command.args[argCount]))
+                {
+                    error = "missing or out-of-range integer argument";
+                    return PARSE_ERROR;
+                }
+                ++argCount;
+
+                p = skipSpaces(p, end);
+                if (p < end && *p == ',')
+                {
+                    p = skipSpaces(p + 1, end);
+                    continue;
+                }
+                break;
+            }
+        }
+
+        if (p == end || *p != ')')
+        {
+            error = "expected ')'";
+            return PARSE_ERROR;
+        }
+        if (p + 1 != end)
+        {
+            error = "unexpected text after ')'";
+            return PARSE_ERROR;
+        }
+        if (argCount < spec->minArgs || argCount > spec->maxArgs)
+        {
+            error = "wrong number of arguments";
+            return PARSE_ERROR;
+        }
+
+        command.type = spec->type;
+        // Print takes one ride number, a range, or a range with an offset and a limit
+        if (spec->type == CMD_PRINT && argCount == 2)
+        {
+            command.type = CMD_PRINT_RANGE;
+        }
+        else if (spec->type == CMD_PRINT && argCount == 3)
+        {
+            error = "wrong number of arguments";
+            return PARSE_ERROR;
+        }
+        else if (spec->type == CMD_PRINT && argCount == 4)
+        {
+            if (command.args[2] < 0 || command.args[3] < 0)
+            {
+                error = "negative offset or limit";
+                return PARSE_ERROR;
+            }
+            command.type = CMD_PRINT_PAGE;
+        }
+        else if ((spec->type == CMD_PEEK_NEXT_RIDES || spec->type == CMD_GET_NEXT_RIDES) && command.args[0] < 0)
+        {
+            error = "negative ride count";
+            return PARSE_ERROR;
+        }
+        command.argCount = argCount;
+        return PARSE_OK;
+    }
+
+private:
+    struct CommandSpec
+    {
+        const char *name;
+        std::size_t length;
+        CommandType type;
+        int minArgs;
+        int maxArgs;
+    };
+
+    static const CommandSpec *findSpec(const char *name, std::size_t length)
+    {
+        static const CommandSpec specs[] = {
+            {"Insert", 6, CMD_INSERT, 3, 3},
+            {"Print", 5, CMD_PRINT, 1, 4},
+            {"UpdateTrip", 10, CMD_UPDATE_TRIP, 2, 2},
+            {"GetNextRide", 11, CMD_GET_NEXT_RIDE, 0, 0},
+            {"CancelRide", 10, CMD_CANCEL_RIDE, 1, 1},
+            {"Snapshot", 8, CMD_SNAPSHOT, 0, 0},
+            {"Count", 5, CMD_COUNT, 2, 2},
+            {"Rank", 4, CMD_RANK, 1, 1},
+            {"Select", 6, CMD_SELECT, 1, 1},
+            {"PeekNextRides", 13, CMD_PEEK_NEXT_RIDES, 1, 1},
+            {"GetNextRides", 12, CMD_GET_NEXT_RIDES, 1, 1},
+        };
+
+        for (const CommandSpec &spec : specs)
+        {
+            if (spec.length == length && std::memcmp(spec.name, name, length) == 0)
+            {
+                return &spec;
+            }
+        }
+        return nullptr;
+    }
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    static const char *skipSpaces(const char *p, const char *end)
+    {
+        while (p < end && isSpace(*p))
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    // Decodes an optionally signed decimal int at p and advances p past it, rejecting overflow
+    static bool parseInt(const char *&p, const char *end, int &value)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            ++p;
+        }
+        if (p == end || *p < '0' || *p > '9')
+        {
+            return false;
+        }
+
+        long long magnitude = 0;
+        const long long limit = negative ? -static_cast<long long>(INT_MIN) : INT_MAX;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            magnitude = magnitude * 10 + (*p - '0');
+            if (magnitude > limit)
+            {
+                return false;
+            }
+            ++p;
+        }
+        value = static_cast<int>(negative ? -magnitude : magnitude);
+        return true;
+    }
+};
+
+#endif
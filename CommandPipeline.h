@@ -0,0 +1,106 @@
+// Pipelined command processing for the long-running modes (--serve, --listen).
+// A reader thread pulls lines from the InputSource and parses them into a single-producer/
+// single-consumer ring, while the calling thread takes the parsed commands off the ring and
+// applies them, so reading and parsing the next commands overlaps with executing the current
+// one. Whenever the ring runs dry the consumer calls idle() before it waits, which is where the
+// caller flushes its output: a command's response goes out as soon as nothing else is queued
+// behind it instead of when a buffer fills up or the input ends. When the run stops early the
+// reader is woken through InputSource::interrupt, so a quiet input does not hold it up.
+
+#ifndef GATORTAXI_COMMANDPIPELINE_H
+#define GATORTAXI_COMMANDPIPELINE_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "CommandParser.h"
+#include "InputSource.h"
+#include "SpscRing.h"
+
+// A parsed command with where it ended in the input
+struct PipelineItem
+{
+    Command command;
+    std::uint64_t inputOffset; // input byte just past the command's line
+    long lineNumber;
+};
+
+class CommandPipeline
+{
+public:
+    static const std::size_t RING_CAPACITY = 4096;
+
+    // Runs until the input ends or process(const PipelineItem &) or idle() returns false, which
+    // stops the reader at once; lineNumber carries on from the given count. Parse errors are
+    // reported on stderr by the reader. Returns false if process or idle stopped the run.
+    template <class Process, class Idle>
+    static bool run(InputSource &input, const std::string &inputName, long lineNumber, Process process, Idle idle)
+    {
+        SpscRing<PipelineItem> ring(RING_CAPACITY);
+        std::thread reader(readCommands, std::ref(input), std::cref(inputName), lineNumber, std::ref(ring));
+
+        bool stopped = false;
+        PipelineItem item;
+        while (true)
+        {
+            if (!ring.tryPop(item))
+            {
+                if (!idle())
+                {
+                    stopped = true;
+                    break;
+                }
+                if (!ring.pop(item))
+                {
+                    break;
+                }
+            }
+            if (!process(static_cast<const PipelineItem &>(item)))
+            {
+                stopped = true;
+                break;
+            }
+        }
+        if (stopped)
+        {
+            ring.close();
+            input.interrupt();
+        }
+        reader.join();
+        return !stopped;
+    }
+
+private:
+    static void readCommands(InputSource &input, const std::string &inputName, long lineNumber, SpscRing<PipelineItem> &ring)
+    {
+        const char *lineBegin;
+        const char *lineEnd;
+        const char *error = nullptr;
+        PipelineItem item;
+        while (!ring.isClosed() && input.nextLine(lineBegin, lineEnd))
+        {
+            ++lineNumber;
+            ParseResult result = CommandParser::parse(lineBegin, lineEnd, item.command, error);
+            if (result == PARSE_EMPTY)
+            {
+                continue;
+            }
+            if (result == PARSE_ERROR)
+            {
+                std::cerr << inputName << ":" << lineNumber << ": " << error << ": " << std::string(lineBegin, lineEnd) << std::endl;
+                continue;
+            }
+            item.inputOffset = input.position();
+            item.lineNumber = lineNumber;
+            if (!ring.push(item))
+            {
+                break;
+            }
+        }
+        ring.close();
+    }
+};
+
+#endif
@@ -0,0 +1,275 @@
+// Line source for the command input.
+// Regular files are memory-mapped and lines are handed out as pointers into the mapping, so no
+// byte is copied before the parser sees it. Pipes, terminals and stdin ("-") cannot be mapped
+// and are read in large chunks into one reusable buffer instead. position() and skipTo() work in
+// byte offsets from the start of the input, which is how a snapshot records where it was taken.
+// A streaming read waits on the descriptor and on a wake-up pipe together, so interrupt() from
+// another thread ends a read that is blocked on a quiet stdin, fifo or socket.
+
+#ifndef GATORTAXI_INPUTSOURCE_H
+#define GATORTAXI_INPUTSOURCE_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class InputSource
+{
+public:
+    InputSource() : fd(-1), mapped(nullptr), mappedSize(0), base(0), cursor(nullptr), limit(nullptr), eof(false)
+    {
+        wake[0] = wake[1] = -1;
+    }
+
+    ~InputSource() { close(); }
+
+    InputSource(const InputSource &) = delete;
+    InputSource &operator=(const InputSource &) = delete;
+
+    // Opens fileName ("-" for stdin); allowMap = false forces the streaming path
+    bool open(const std::string &fileName, bool allowMap = true)
+    {
+        close();
+        fd = fileName == "-" ? STDIN_FILENO : ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            error = std::strerror(errno);
+            return false;
+        }
+
+        struct stat info;
+        if (allowMap && fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        {
+            void *region = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (region != MAP_FAILED)
+            {
+#ifdef MADV_SEQUENTIAL
+                madvise(region, info.st_size, MADV_SEQUENTIAL);
+#endif
+                mapped = static_cast<const char *>(region);
+                mappedSize = info.st_size;
+                cursor = mapped;
+                limit = mapped + mappedSize;
+                eof = true;
+                return true;
+            }
+        }
+
+        // Streaming fallback, also used for an empty regular file
+        buffer.resize(CHUNK_SIZE);
+        cursor = limit = buffer.data();
+        openWake();
+        return true;
+    }
+
+    // Reads from an already open descriptor (a socket connection, say) through the streaming
+    // path; the descriptor is closed with the source
+    void attach(int descriptor)
+    {
+        close();
+        error.clear();
+        fd = descriptor;
+        buffer.resize(CHUNK_SIZE);
+        cursor = limit = buffer.data();
+        openWake();
+    }
+
+    // Ends the input as if it had reached its end: a read blocked in nextLine returns and every
+    // later one finds nothing. Safe to call from another thread while the source is open
+    void interrupt()
+    {
+        if (wake[1] >= 0)
+        {
+            char byte = 0;
+            ssize_t count;
+            do
+            {
+                count = ::write(wake[1], &byte, 1);
+            } while (count < 0 && errno == EINTR);
+        }
+    }
+
+    // Byte offset of the next line from the start of the input
+    std::uint64_t position() const { return mapped ? cursor - mapped : base + (cursor - buffer.data()); }
+
+    // Moves forward to the given byte offset, seeking where the descriptor allows it and reading
+    // past the bytes otherwise (pipes, stdin); returns false if the input ends before it
+    bool skipTo(std::uint64_t offset)
+    {
+        if (offset < position())
+        {
+            return false;
+        }
+        if (mapped)
+        {
+            if (offset > mappedSize)
+            {
+                return false;
+            }
+            cursor = mapped + offset;
+            return true;
+        }
+        if (offset > position() + (limit - cursor) && lseek(fd, static_cast<off_t>(offset), SEEK_SET) >= 0)
+        {
+            base = offset;
+            cursor = limit = buffer.data();
+            return true;
+        }
+        while (position() < offset)
+        {
+            if (cursor == limit)
+            {
+                if (eof)
+                {
+                    return false;
+                }
+                refill();
+                continue;
+            }
+            std::uint64_t remaining = offset - position();
+            cursor += remaining < static_cast<std::uint64_t>(limit - cursor) ? remaining : limit - cursor;
+        }
+        return true;
+    }
+
+    // Yields the next line without its '\n'; returns false at end of input
+    bool nextLine(const char *&begin, const char *&end)
+    {
+        while (true)
+        {
+            const char *newline = cursor < limit ? static_cast<const char *>(std::memchr(cursor, '\n', limit - cursor)) : nullptr;
+            if (newline)
+            {
+                begin = cursor;
+                end = newline;
+                cursor = newline + 1;
+                return true;
+            }
+            if (eof)
+            {
+                // Last line without a trailing newline
+                if (cursor < limit)
+                {
+                    begin = cursor;
+                    end = limit;
+                    cursor = limit;
+                    return true;
+                }
+                return false;
+            }
+            refill();
+        }
+    }
+
+    bool isMapped() const { return mapped != nullptr; }
+    // A regular file (also behind stdin) is read from its start again by every run
+    bool isRegularFile() const
+    {
+        struct stat info;
+        return fd >= 0 && fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+    }
+    const std::string &lastError() const { return error; }
+
+    void close()
+    {
+        if (mapped)
+        {
+            munmap(const_cast<char *>(mapped), mappedSize);
+            mapped = nullptr;
+        }
+        if (fd > STDIN_FILENO)
+        {
+            ::close(fd);
+        }
+        fd = -1;
+        for (int &end : wake)
+        {
+            if (end >= 0)
+                ::close(end);
+            end = -1;
+        }
+        base = 0;
+        cursor = limit = nullptr;
+        eof = false;
+    }
+
+private:
+    static const std::size_t CHUNK_SIZE = 1 << 20;
+
+    int fd;
+    const char *mapped;
+    std::size_t mappedSize;
+    std::vector<char> buffer;
+    std::uint64_t base; // input offset of buffer[0] on the streaming path
+    const char *cursor;
+    const char *limit;
+    bool eof;
+    int wake[2]; // read and write ends of the interrupt() pipe, -1 on the mapped path
+    std::string error;
+
+    // Without the pipe interrupt() does nothing and reads block as before
+    void openWake()
+    {
+        if (::pipe(wake) != 0)
+        {
+            wake[0] = wake[1] = -1;
+        }
+    }
+
+    // Moves the unfinished line to the front of the buffer and reads the next chunk behind it.
+    // The buffer only grows, doubling, once the unfinished line takes up more than half of it;
+    // a short tail carried over from the last chunk just makes the next read that much smaller.
+    void refill()
+    {
+        std::size_t pending = limit - cursor;
+        base += cursor - buffer.data();
+        std::memmove(buffer.data(), cursor, pending);
+        if (pending > buffer.size() / 2)
+        {
+            buffer.resize(2 * buffer.size()); // a single line longer than half the buffer
+        }
+
+        ssize_t count;
+        if (wake[0] >= 0)
+        {
+            pollfd waits[2] = {{fd, POLLIN, 0}, {wake[0], POLLIN, 0}};
+            while (::poll(waits, 2, -1) < 0 && errno == EINTR)
+            {
+            }
+            if (waits[1].revents)
+            {
+                eof = true;
+                cursor = buffer.data();
+                limit = cursor + pending;
+                return;
+            }
+        }
+        do
+        {
+            count = ::read(fd, buffer.data() + pending, buffer.size() - pending);
+        } while (count < 0 && errno == EINTR);
+
+        if (count <= 0)
+        {
+            if (count < 0)
+            {
+                error = std::strerror(errno);
+            }
+            eof = true;
+            count = 0;
+        }
+        cursor = buffer.data();
+        limit = cursor + pending + count;
+    }
+};
+
+#endif
@@ -0,0 +1,282 @@
+// Min Heap class for storing the rides in order of cost and duration, the default RideQueue backend.
+// The heap holds the tree nodes themselves and keeps RBTNode::heapIndex in sync
+// on every move, so remove and update locate a ride in O(1) and fix the heap in O(log n).
+// Storage grows on demand and is given back once a large drain leaves it mostly empty.
+// Rides equal on cost and duration come out in whatever order the layout gives, so by default
+// every operation moves entries exactly as the original heap did (an update is a remove and a
+// reinsert, a batch is sifted up one ride at a time) and the output matches it tie for tie.
+// With rideNumberTies set, equal rides are ordered by ride number instead; the layout no longer
+// matters then, so updates sift in place and a large batch is heapified bottom-up.
+// BasicMinHeap takes the node type, the ordering and the number of children per slot as template
+// parameters, so the comparison is inlined into the sift loops; MinHeap is the binary heap of
+// RBTNodes ordered by RideOrder that gatorTaxi uses.
+
+#ifndef GATORTAXI_MINHEAP_H
+#define GATORTAXI_MINHEAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "RBTNode.h"
+#include "RideQueue.h"
+
+// Orders nodes by cost, then duration, and with rideNumberTies by ride number after that.
+// isTotal() tells the heap whether two different rides can ever compare equal.
+struct RideOrder
+{
+    bool rideNumberTies;
+
+    explicit RideOrder(bool rideNumberTies = false) : rideNumberTies(rideNumberTies) {}
+
+    bool isTotal() const { return rideNumberTies; }
+
+    template <class Node>
+    bool operator()(const Node *a, const Node *b) const
+    {
+        return rideNumberTies ? a->ride.compareTotal(b->ride) < 0 : a->ride.compareTo(b->ride) < 0;
+    }
+};
+
+template <class Node, class Compare, int Arity>
+class BasicMinHeap final : public BasicRideQueue<Node>
+{
+private:
+    static_assert(Arity >= 2, "a heap slot needs at least two children");
+
+    std::vector<Node *> heap;
+    int size;
+    std::size_t initialCapacity;
+    Compare less;
+
+    int parent(int i) const { return (i - 1) / Arity; }
+    int firstChild(int i) const { return Arity * i + 1; }
+
+    // Place node at slot i and record the slot in the node
+    void place(int i, Node *node)
+    {
+        heap[i] = node;
+        node->heapIndex = i;
+    }
+
+    void swapSlots(int i, int j)
+    {
+        Node *tmp = heap[i];
+        place(i, heap[j]);
+        place(j, tmp);
+    }
+
+    void siftUp(int i);
+    void siftDown(int i);
+    void shrinkIfSparse();
+
+public:
+    BasicMinHeap(std::size_t initialCapacity, Compare less = Compare()) : size(0), initialCapacity(initialCapacity), less(less) { heap.reserve(initialCapacity); }
+
+    bool isEmpty() const override { return size == 0; }
+    int getSize() const override { return size; }
+    std::size_t getCapacity() const override { return heap.capacity(); }
+    Node *getMin() const override { return heap[0]; }
+    void insert(Node *node) override;
+    void insertAll(const std::vector<Node *> &nodes) override;
+    Node *extractMin() override;
+    void remove(Node *node) override;
+    void update(Node *node) override;
+    void peekSmallest(std::size_t k, std::vector<Node *> &out) const override;
+};
+
+typedef BasicMinHeap<RBTNode, RideOrder, 2> MinHeap;
+
+// siftUp function for the Min Heap
+template <class Node, class Compare, int Arity>
+inline void BasicMinHeap<Node, Compare, Arity>::siftUp(int i)
+{
+    while (i > 0 && less(heap[i], heap[parent(i)]))
+    {
+        swapSlots(parent(i), i);
+        i = parent(i);
+    }
+}
+
+// siftDown function for the Min Heap, moves to the first of the smallest children
+template <class Node, class Compare, int Arity>
+inline void BasicMinHeap<Node, Compare, Arity>::siftDown(int i)
+{
+    while (true)
+    {
+        int minIndex = i;
+        int first = firstChild(i);
+        int last = std::min(first + Arity, size);
+        for (int child = first; child < last; ++child)
+        {
+            if (less(heap[child], heap[minIndex]))
+            {
+                minIndex = child;
+            }
+        }
+
+        if (i == minIndex)
+        {
+            return;
+        }
+        swapSlots(i, minIndex);
+        i = minIndex;
+    }
+}
+
+// shrinkIfSparse function for the Min Heap
+// Once the heap is down to a quarter of its storage, reallocate to twice its size (never below
+// the initial reservation). Growing back takes as many inserts as the drain took removals, so
+// the copy stays amortized O(1) and a burst does not pin its peak memory afterwards.
+template <class Node, class Compare, int Arity>
+inline void BasicMinHeap<Node, Compare, Arity>::shrinkIfSparse()
+{
+    std::size_t capacity = heap.capacity();
+    if (capacity <= initialCapacity || static_cast<std::size_t>(size) >= capacity / 4)
+    {
+        return;
+    }
+
+    std::vector<Node *> smaller;
+    smaller.reserve(std::max(initialCapacity, 2 * static_cast<std::size_t>(size)));
+    smaller.assign(heap.begin(), heap.end());
+    heap.swap(smaller);
+}
+
+// insert function for the Min Heap, storage grows geometrically so appends are amortized O(1)
+template <class Node, class Compare, int Arity>
+inline void BasicMinHeap<Node, Compare, Arity>::insert(Node *node)
+{
+    heap.push_back(node);
+    node->heapIndex = size;
+    siftUp(size++);
+}
+
+// insertAll function for the Min Heap
+// With a total order, a batch at least as large as the heap is appended and the whole heap
+// rebuilt bottom-up (Floyd's build-heap, O(size)); otherwise, and for smaller batches, the rides
+// are sifted up one by one in batch order, as that many inserts would. Storage grows
+// geometrically like insert, so a log of many small batches stays amortized O(1) per ride.
+template <class Node, class Compare, int Arity>
+inline void BasicMinHeap<Node, Compare, Arity>::insertAll(const std::vector<Node *> &nodes)
+{
+    int oldSize = size;
+    std::size_t needed = heap.size() + nodes.size();
+    if (needed > heap.capacity())
+    {
+        heap.reserve(std::max(needed, 2 * heap.capacity()));
+    }
+    for (Node *node : nodes)
+    {
+        heap.push_back(node);
+        node->heapIndex = size++;
+    }
+
+    if (less.isTotal() && static_cast<int>(nodes.size()) >= oldSize)
+    {
+        for (int i = size > 1 ? parent(size - 1) : -1; i >= 0; --i)
+        {
+            siftDown(i);
+        }
+    }
+    else
+    {
+        for (int i = oldSize; i < size; ++i)
+        {
+            siftUp(i);
+        }
+    }
+}
+
+// extractMin function for the Min Heap
+template <class Node, class Compare, int Arity>
+inline Node *BasicMinHeap<Node, Compare, Arity>::extractMin()
+{
+    if (isEmpty())
+    {
+        throw std::underflow_error("No elements in the heap");
+    }
+
+    Node *result = heap[0];
+    place(0, heap[--size]);
+    heap.pop_back();
+    siftDown(0);
+    shrinkIfSparse();
+
+    result->heapIndex = -1;
+    return result;
+}
+
+// remove function for the Min Heap, a no-op if the node is not in the heap
+template <class Node, class Compare, int Arity>
+inline void BasicMinHeap<Node, Compare, Arity>::remove(Node *node)
+{
+    int i = node->heapIndex;
+    if (i < 0)
+    {
+        return;
+    }
+    node->heapIndex = -1;
+    if (i == --size)
+    {
+        heap.pop_back();
+    }
+    else
+    {
+        place(i, heap[size]);
+        heap.pop_back();
+        siftDown(i);
+        siftUp(i);
+    }
+    shrinkIfSparse();
+}
+
+// update function for the Min Heap, restores heap order after the node's cost or duration changed
+template <class Node, class Compare, int Arity>
+inline void BasicMinHeap<Node, Compare, Arity>::update(Node *node)
+{
+    int i = node->heapIndex;
+    if (i < 0)
+    {
+        return;
+    }
+    if (!less.isTotal())
+    {
+        remove(node);
+        insert(node);
+        return;
+    }
+    siftUp(i);
+    siftDown(node->heapIndex);
+}
+
+// peekSmallest function for the Min Heap, O(k log k)
+// Every slot taken hands its children to the frontier, a heap of slots ordered by their rides
+template <class Node, class Compare, int Arity>
+inline void BasicMinHeap<Node, Compare, Arity>::peekSmallest(std::size_t k, std::vector<Node *> &out) const
+{
+    if (size == 0 || k == 0)
+    {
+        return;
+    }
+    std::vector<int> frontier(1, 0);
+    frontier.reserve((Arity - 1) * std::min<std::size_t>(k, size) + 2);
+    auto after = [this](int a, int b) { return less(heap[b], heap[a]); };
+    while (k-- && !frontier.empty())
+    {
+        std::pop_heap(frontier.begin(), frontier.end(), after);
+        int i = frontier.back();
+        frontier.pop_back();
+        out.push_back(heap[i]);
+        int first = firstChild(i);
+        int last = std::min(first + Arity, size);
+        for (int child = first; child < last; ++child)
+        {
+            frontier.push_back(child);
+            std::push_heap(frontier.begin(), frontier.end(), after);
+        }
+    }
+}
+
+#endif
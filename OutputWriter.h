@@ -0,0 +1,237 @@
+// Buffered output sink for command results.
+// Results are formatted straight into one large reusable buffer, with integers converted by
+// hand instead of through streams, and the buffer is only written out when it fills up or on
+// an explicit flush() checkpoint. Nothing is flushed per line. position() counts every byte
+// written so far, and openAt() cuts an existing file back to such a position and carries on
+// from there, which is how a restart from a snapshot resumes the output.
+
+#ifndef GATORTAXI_OUTPUTWRITER_H
+#define GATORTAXI_OUTPUTWRITER_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Ride.h"
+
+class OutputWriter
+{
+public:
+    static const std::size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    OutputWriter(std::size_t bufferSize = DEFAULT_BUFFER_SIZE) : fd(-1), text(nullptr), used(0), written(0) { buffer.resize(bufferSize); }
+
+    ~OutputWriter() { close(); }
+
+    OutputWriter(const OutputWriter &) = delete;
+    OutputWriter &operator=(const OutputWriter &) = delete;
+
+    // Opens (truncating) the output file, "-" writes to stdout
+    bool open(const std::string &fileName)
+    {
+        close();
+        fd = fileName == "-" ? STDOUT_FILENO : ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            error = std::strerror(errno);
+            return false;
+        }
+        written = 0;
+        return true;
+    }
+
+    // Opens the output file without truncating it, cuts it back to offset bytes and appends from
+    // there; fails if the file is shorter than that. "-" just continues counting from offset.
+    bool openAt(const std::string &fileName, std::uint64_t offset)
+    {
+        close();
+        written = offset;
+        if (fileName == "-")
+        {
+            fd = STDOUT_FILENO;
+            return true;
+        }
+        fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            error = std::strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<std::uint64_t>(info.st_size) < offset)
+        {
+            error = "output file is shorter than the snapshot records";
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(offset)) != 0 || lseek(fd, static_cast<off_t>(offset), SEEK_SET) < 0)
+        {
+            error = std::strerror(errno);
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    // Writes to an already open descriptor, which is closed with the writer
+    void attach(int descriptor)
+    {
+        close();
+        error.clear();
+        fd = descriptor;
+        written = 0;
+    }
+
+    // Appends everything written to target instead of a file, until close()
+    void openString(std::string &target)
+    {
+        close();
+        error.clear();
+        text = &target;
+        written = 0;
+    }
+
+    // Bytes written since the file was opened (or since offset, for openAt), buffered ones included
+    std::uint64_t position() const { return written + used; }
+
+    void write(const char *data, std::size_t length)
+    {
+        if (length > buffer.size() - used)
+        {
+            flush();
+            if (length > buffer.size())
+            {
+                writeAll(data, length);
+                return;
+            }
+        }
+        std::memcpy(buffer.data() + used, data, length);
+        used += length;
+    }
+
+    void write(const char *text) { write(text, std::strlen(text)); }
+
+    void put(char c)
+    {
+        if (used == buffer.size())
+        {
+            flush();
+        }
+        buffer[used++] = c;
+    }
+
+    void writeInt(int value) { writeInteger(value); }
+    void writeInt(long long value) { writeInteger(value); }
+
+    // Writes a ride as (rideNumber,rideCost,tripDuration)
+    template <class Key>
+    void writeRide(const BasicRide<Key> &ride)
+    {
+        put('(');
+        writeInt(ride.rideNumber);
+        put(',');
+        writeInt(ride.rideCost);
+        put(',');
+        writeInt(ride.tripDuration);
+        put(')');
+    }
+
+    // Checkpoint: hands everything buffered so far to the operating system
+    void flush()
+    {
+        if (used)
+        {
+            writeAll(buffer.data(), used);
+            used = 0;
+        }
+    }
+
+    void close()
+    {
+        if (text)
+        {
+            flush();
+            text = nullptr;
+            return;
+        }
+        if (fd < 0)
+        {
+            return;
+        }
+        flush();
+        if (fd > STDERR_FILENO)
+        {
+            ::close(fd);
+        }
+        fd = -1;
+    }
+
+    const std::string &lastError() const { return error; }
+
+private:
+    // Digits of an int or long long; int keeps its 32-bit division
+    template <class Integer>
+    void writeInteger(Integer value)
+    {
+        typedef typename std::make_unsigned<Integer>::type Magnitude;
+        char digits[21];
+        char *end = digits + sizeof(digits);
+        char *p = end;
+        // Work on the unsigned magnitude so the most negative value does not overflow
+        Magnitude magnitude = value < 0 ? Magnitude(0) - static_cast<Magnitude>(value) : static_cast<Magnitude>(value);
+        do
+        {
+            *--p = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+        if (value < 0)
+        {
+            *--p = '-';
+        }
+        write(p, end - p);
+    }
+
+    int fd;
+    std::string *text; // set by openString
+    std::vector<char> buffer;
+    std::size_t used;
+    std::uint64_t written; // bytes handed to writeAll
+    std::string error;
+
+    void writeAll(const char *data, std::size_t length)
+    {
+        written += length;
+        if (text)
+        {
+            text->append(data, length);
+            return;
+        }
+        while (length && fd >= 0)
+        {
+            ssize_t count = ::write(fd, data, length);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                error = std::strerror(errno);
+                return;
+            }
+            data += count;
+            length -= count;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,324 @@
+// 8-ary struct-of-arrays heap backend for the pending rides (see RideQueue.h), --queue packed.
+// The (cost, duration) order of each ride is packed into one signed 64-bit key, and the keys
+// are kept in their own array, apart from the node pointers. The root sits in slot 7, so the
+// eight children of any slot fill exactly one 64-byte-aligned cache line of keys. siftDown
+// therefore reads one line per level over a tree a third as deep as the binary heap, picking
+// the smallest child with two 256-bit compares where AVX2 is available (build with -mavx2 or
+// -march=native), and a plain loop elsewhere. Equal keys fall back to the ride number, so the
+// order is the same total order as Ride::compareTotal.
+
+#ifndef GATORTAXI_PACKEDHEAP_H
+#define GATORTAXI_PACKEDHEAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "RBTNode.h"
+#include "RideQueue.h"
+
+class PackedHeap final : public RideQueue
+{
+private:
+    static const int ARITY = 8;
+    static const int ROOT = ARITY - 1;
+
+    std::int64_t *keys;
+    RBTNode **nodes;
+    int end; // one past the last used slot
+    std::size_t capacity; // slots, including the ROOT unused ones in front
+    std::size_t initialCapacity;
+
+    static int firstChild(int slot) { return ARITY * (slot - ROOT + 1); }
+    static int parent(int slot) { return slot / ARITY + ROOT - 1; }
+
+    // Signed 64-bit key ordered like (rideCost, tripDuration)
+    static std::int64_t packKey(const Ride &ride)
+    {
+        return static_cast<std::int64_t>(ride.rideCost) * 4294967296LL + (static_cast<std::uint32_t>(ride.tripDuration) ^ 0x80000000u);
+    }
+
+    bool less(std::int64_t keyA, const RBTNode *a, std::int64_t keyB, const RBTNode *b) const
+    {
+        return keyA < keyB || (keyA == keyB && a->ride.rideNumber < b->ride.rideNumber);
+    }
+
+    void place(int slot, std::int64_t key, RBTNode *node)
+    {
+        keys[slot] = key;
+        nodes[slot] = node;
+        node->heapIndex = slot;
+    }
+
+    int minChild(int first, int count) const;
+    void siftUp(int slot, std::int64_t key, RBTNode *node);
+    void siftDown(int slot, std::int64_t key, RBTNode *node);
+    void reallocate(std::size_t slots);
+    void shrinkIfSparse();
+
+public:
+    PackedHeap(std::size_t initialCapacity) : keys(nullptr), nodes(nullptr), end(ROOT), capacity(0), initialCapacity(initialCapacity + ROOT)
+    {
+        reallocate(this->initialCapacity);
+    }
+
+    ~PackedHeap()
+    {
+        std::free(keys);
+        std::free(nodes);
+    }
+
+    PackedHeap(const PackedHeap &) = delete;
+    PackedHeap &operator=(const PackedHeap &) = delete;
+
+    bool isEmpty() const override { return end == ROOT; }
+    int getSize() const override { return end - ROOT; }
+    std::size_t getCapacity() const override { return capacity - ROOT; }
+    RBTNode *getMin() const override { return nodes[ROOT]; }
+    void insert(RBTNode *node) override;
+    void insertAll(const std::vector<RBTNode *> &batch) override;
+    RBTNode *extractMin() override;
+    void remove(RBTNode *node) override;
+    void update(RBTNode *node) override;
+    void peekSmallest(std::size_t k, std::vector<RBTNode *> &out) const override;
+};
+
+// minChild function for the Packed Heap, slot of the smallest of count children from first
+inline int PackedHeap::minChild(int first, int count) const
+{
+#if defined(__AVX2__)
+    if (count == ARITY)
+    {
+        __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + first));
+        __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + first + 4));
+        __m256i smallest = _mm256_blendv_epi8(low, high, _mm256_cmpgt_epi64(low, high));
+        __m256i swapped = _mm256_permute4x64_epi64(smallest, _MM_SHUFFLE(1, 0, 3, 2));
+        smallest = _mm256_blendv_epi8(smallest, swapped, _mm256_cmpgt_epi64(smallest, swapped));
+        swapped = _mm256_permute4x64_epi64(smallest, _MM_SHUFFLE(2, 3, 0, 1));
+        smallest = _mm256_blendv_epi8(smallest, swapped, _mm256_cmpgt_epi64(smallest, swapped));
+
+        // Every lane now holds the minimum; find which children carry it
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(low, smallest)))) |
+                        static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(high, smallest)))) << 4;
+        int best = first + __builtin_ctz(mask);
+        for (mask &= mask - 1; mask; mask &= mask - 1)
+        {
+            int other = first + __builtin_ctz(mask);
+            if (nodes[other]->ride.rideNumber < nodes[best]->ride.rideNumber)
+                best = other;
+        }
+        return best;
+    }
+#endif
+    int best = first;
+    for (int child = first + 1; child < first + count; ++child)
+    {
+        if (less(keys[child], nodes[child], keys[best], nodes[best]))
+            best = child;
+    }
+    return best;
+}
+
+// siftUp function for the Packed Heap, moves larger parents down into the hole until the node fits
+inline void PackedHeap::siftUp(int slot, std::int64_t key, RBTNode *node)
+{
+    while (slot > ROOT)
+    {
+        int up = parent(slot);
+        if (!less(key, node, keys[up], nodes[up]))
+        {
+            break;
+        }
+        place(slot, keys[up], nodes[up]);
+        slot = up;
+    }
+    place(slot, key, node);
+}
+
+// siftDown function for the Packed Heap
+inline void PackedHeap::siftDown(int slot, std::int64_t key, RBTNode *node)
+{
+    while (true)
+    {
+        int first = firstChild(slot);
+        if (first >= end)
+        {
+            break;
+        }
+        int count = end - first;
+        int child = minChild(first, count < ARITY ? count : ARITY);
+        if (!less(keys[child], nodes[child], key, node))
+        {
+            break;
+        }
+        place(slot, keys[child], nodes[child]);
+        slot = child;
+    }
+    place(slot, key, node);
+}
+
+// reallocate function for the Packed Heap, moves both arrays to 64-byte-aligned storage of the given size
+inline void PackedHeap::reallocate(std::size_t slots)
+{
+    // Whole cache lines, so a full group of children never straddles the end
+    slots = (slots + ARITY - 1) / ARITY * ARITY;
+    void *newKeys = nullptr;
+    void *newNodes = nullptr;
+    if (posix_memalign(&newKeys, 64, slots * sizeof(std::int64_t)) != 0 || posix_memalign(&newNodes, 64, slots * sizeof(RBTNode *)) != 0)
+    {
+        std::free(newKeys);
+        throw std::bad_alloc();
+    }
+    if (keys)
+    {
+        std::memcpy(newKeys, keys, end * sizeof(std::int64_t));
+        std::memcpy(newNodes, nodes, end * sizeof(RBTNode *));
+        std::free(keys);
+        std::free(nodes);
+    }
+    keys = static_cast<std::int64_t *>(newKeys);
+    nodes = static_cast<RBTNode **>(newNodes);
+    capacity = slots;
+}
+
+// shrinkIfSparse function for the Packed Heap, same policy as MinHeap::shrinkIfSparse
+inline void PackedHeap::shrinkIfSparse()
+{
+    std::size_t used = end - ROOT;
+    if (capacity <= initialCapacity || used >= (capacity - ROOT) / 4)
+    {
+        return;
+    }
+    reallocate(std::max(initialCapacity, ROOT + 2 * used));
+}
+
+// insert function for the Packed Heap, storage doubles when full so appends are amortized O(1)
+inline void PackedHeap::insert(RBTNode *node)
+{
+    if (static_cast<std::size_t>(end) == capacity)
+    {
+        reallocate(2 * capacity);
+    }
+    siftUp(end++, packKey(node->ride), node);
+}
+
+// insertAll function for the Packed Heap
+// A batch at least as large as the heap is appended and the whole heap rebuilt bottom-up,
+// smaller batches are sifted up one by one.
+inline void PackedHeap::insertAll(const std::vector<RBTNode *> &batch)
+{
+    int oldSize = getSize();
+    std::size_t needed = end + batch.size();
+    if (needed > capacity)
+    {
+        reallocate(std::max(needed, 2 * capacity));
+    }
+
+    if (static_cast<int>(batch.size()) < oldSize)
+    {
+        for (RBTNode *node : batch)
+        {
+            siftUp(end++, packKey(node->ride), node);
+        }
+        return;
+    }
+
+    for (RBTNode *node : batch)
+    {
+        place(end++, packKey(node->ride), node);
+    }
+    for (int slot = parent(end - 1); slot >= ROOT; --slot)
+    {
+        siftDown(slot, keys[slot], nodes[slot]);
+    }
+}
+
+// extractMin function for the Packed Heap
+inline RBTNode *PackedHeap::extractMin()
+{
+    if (isEmpty())
+    {
+        throw std::underflow_error("No elements in the heap");
+    }
+
+    RBTNode *result = nodes[ROOT];
+    --end;
+    if (end > ROOT)
+    {
+        siftDown(ROOT, keys[end], nodes[end]);
+    }
+    shrinkIfSparse();
+
+    result->heapIndex = -1;
+    return result;
+}
+
+// remove function for the Packed Heap, a no-op if the node is not in the heap
+inline void PackedHeap::remove(RBTNode *node)
+{
+    int slot = node->heapIndex;
+    if (slot < 0)
+    {
+        return;
+    }
+    node->heapIndex = -1;
+    --end;
+    if (slot != end)
+    {
+        std::int64_t key = keys[end];
+        RBTNode *last = nodes[end];
+        siftDown(slot, key, last);
+        siftUp(last->heapIndex, key, last);
+    }
+    shrinkIfSparse();
+}
+
+// update function for the Packed Heap, re-packs the node's key and restores heap order
+inline void PackedHeap::update(RBTNode *node)
+{
+    int slot = node->heapIndex;
+    if (slot < 0)
+    {
+        return;
+    }
+    std::int64_t key = packKey(node->ride);
+    siftUp(slot, key, node);
+    siftDown(node->heapIndex, key, node);
+}
+
+// peekSmallest function for the Packed Heap, O(k log k) with each slot taken handing its eight
+// children to the frontier
+inline void PackedHeap::peekSmallest(std::size_t k, std::vector<RBTNode *> &out) const
+{
+    if (isEmpty() || k == 0)
+    {
+        return;
+    }
+    std::vector<int> frontier(1, static_cast<int>(ROOT));
+    frontier.reserve(ARITY * std::min<std::size_t>(k, getSize()) + 1);
+    auto after = [this](int a, int b) { return less(keys[b], nodes[b], keys[a], nodes[a]); };
+    while (k-- && !frontier.empty())
+    {
+        std::pop_heap(frontier.begin(), frontier.end(), after);
+        int slot = frontier.back();
+        frontier.pop_back();
+        out.push_back(nodes[slot]);
+        int first = firstChild(slot);
+        for (int child = first; child < first + ARITY && child < end; ++child)
+        {
+            frontier.push_back(child);
+            std::push_heap(frontier.begin(), frontier.end(), after);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,305 @@
+// Pairing Heap backend for the pending rides (see RideQueue.h).
+// Insert and meld are O(1), extractMin does the usual two-pass pairing of the root's children
+// (O(log n) amortized), and a ride whose key went down is simply cut from its parent and melded
+// with the root, which suits the update-heavy UpdateTrip traffic.
+// Heap entries live in one array, linked by index; RBTNode::heapIndex is the node's entry.
+// Each entry keeps a copy of the ride's key, so comparisons stay inside the array and update
+// can tell a decrease from an increase.
+
+#ifndef GATORTAXI_PAIRINGHEAP_H
+#define GATORTAXI_PAIRINGHEAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "RBTNode.h"
+#include "RideQueue.h"
+
+class PairingHeap final : public RideQueue
+{
+private:
+    struct Entry
+    {
+        Ride key;
+        RBTNode *node;
+        int child;   // leftmost child
+        int sibling; // next sibling to the right
+        int prev;    // parent for a leftmost child, otherwise the sibling to the left; -1 for the root
+    };
+
+    std::vector<Entry> entries;
+    std::vector<int> freeEntries;
+    std::vector<int> pairs; // scratch list for mergePairs
+    int root;
+    int size;
+    std::size_t initialCapacity;
+
+    bool less(int a, int b) const { return entries[a].key.compareTotal(entries[b].key) < 0; }
+
+    int acquire(RBTNode *node);
+    void release(int e);
+    int meld(int a, int b);
+    int mergePairs(int first);
+    void cut(int e);
+
+public:
+    PairingHeap(std::size_t initialCapacity) : root(-1), size(0), initialCapacity(initialCapacity) { entries.reserve(initialCapacity); }
+
+    bool isEmpty() const override { return size == 0; }
+    int getSize() const override { return size; }
+    std::size_t getCapacity() const override { return entries.capacity(); }
+    RBTNode *getMin() const override { return entries[root].node; }
+    void insert(RBTNode *node) override;
+    void insertAll(const std::vector<RBTNode *> &nodes) override;
+    RBTNode *extractMin() override;
+    void remove(RBTNode *node) override;
+    void update(RBTNode *node) override;
+    void peekSmallest(std::size_t k, std::vector<RBTNode *> &out) const override;
+};
+
+// acquire function for the Pairing Heap, takes a free entry for the node
+inline int PairingHeap::acquire(RBTNode *node)
+{
+    Entry entry = {node->ride, node, -1, -1, -1};
+    int e;
+    if (freeEntries.empty())
+    {
+        e = static_cast<int>(entries.size());
+        entries.push_back(entry);
+    }
+    else
+    {
+        e = freeEntries.back();
+        freeEntries.pop_back();
+        entries[e] = entry;
+    }
+    node->heapIndex = e;
+    return e;
+}
+
+// release function for the Pairing Heap
+// Once the heap runs empty the entry array starts over, giving back what a burst grew it to
+inline void PairingHeap::release(int e)
+{
+    entries[e].node->heapIndex = -1;
+    if (size > 0)
+    {
+        freeEntries.push_back(e);
+        return;
+    }
+    freeEntries.clear();
+    if (entries.capacity() > initialCapacity)
+    {
+        std::vector<Entry> fresh;
+        fresh.reserve(initialCapacity);
+        entries.swap(fresh);
+    }
+    else
+    {
+        entries.clear();
+    }
+}
+
+// meld function for the Pairing Heap, links two roots and returns the new one
+inline int PairingHeap::meld(int a, int b)
+{
+    if (a < 0)
+        return b;
+    if (b < 0)
+        return a;
+    if (less(b, a))
+        std::swap(a, b);
+
+    Entry &top = entries[a];
+    Entry &below = entries[b];
+    below.sibling = top.child;
+    if (top.child >= 0)
+    {
+        entries[top.child].prev = b;
+    }
+    below.prev = a;
+    top.child = b;
+    return a;
+}
+
+// mergePairs function for the Pairing Heap
+// Melds a sibling list into one tree: neighbours in pairs from the left, then the pairs from the right
+inline int PairingHeap::mergePairs(int first)
+{
+    if (first < 0)
+    {
+        return -1;
+    }
+
+    pairs.clear();
+    for (int e = first; e >= 0;)
+    {
+        int next = entries[e].sibling;
+        entries[e].sibling = -1;
+        entries[e].prev = -1;
+        pairs.push_back(e);
+        e = next;
+    }
+
+    std::size_t count = 0;
+    std::size_t i = 0;
+    for (; i + 1 < pairs.size(); i += 2)
+    {
+        pairs[count++] = meld(pairs[i], pairs[i + 1]);
+    }
+    if (i < pairs.size())
+    {
+        pairs[count++] = pairs[i];
+    }
+
+    int result = pairs[--count];
+    while (count > 0)
+    {
+        result = meld(pairs[--count], result);
+    }
+    return result;
+}
+
+// cut function for the Pairing Heap, detaches a non-root entry (with its subtree) from its parent
+inline void PairingHeap::cut(int e)
+{
+    Entry &entry = entries[e];
+    if (entries[entry.prev].child == e)
+    {
+        entries[entry.prev].child = entry.sibling;
+    }
+    else
+    {
+        entries[entry.prev].sibling = entry.sibling;
+    }
+    if (entry.sibling >= 0)
+    {
+        entries[entry.sibling].prev = entry.prev;
+    }
+    entry.prev = -1;
+    entry.sibling = -1;
+}
+
+// insert function for the Pairing Heap
+inline void PairingHeap::insert(RBTNode *node)
+{
+    root = meld(root, acquire(node));
+    ++size;
+}
+
+// insertAll function for the Pairing Heap, each insert is already O(1)
+inline void PairingHeap::insertAll(const std::vector<RBTNode *> &nodes)
+{
+    for (RBTNode *node : nodes)
+    {
+        insert(node);
+    }
+}
+
+// extractMin function for the Pairing Heap
+inline RBTNode *PairingHeap::extractMin()
+{
+    if (isEmpty())
+    {
+        throw std::underflow_error("No elements in the heap");
+    }
+
+    int top = root;
+    RBTNode *result = entries[top].node;
+    root = mergePairs(entries[top].child);
+    --size;
+    release(top);
+    return result;
+}
+
+// remove function for the Pairing Heap, a no-op if the node is not in the heap
+inline void PairingHeap::remove(RBTNode *node)
+{
+    int e = node->heapIndex;
+    if (e < 0)
+    {
+        return;
+    }
+    if (e == root)
+    {
+        root = mergePairs(entries[e].child);
+    }
+    else
+    {
+        cut(e);
+        root = meld(root, mergePairs(entries[e].child));
+    }
+    --size;
+    release(e);
+}
+
+// update function for the Pairing Heap
+// A smaller key only needs the entry cut and melded with the root; a larger one may now be out
+// of order with its own children, so those are paired up and melded back separately.
+inline void PairingHeap::update(RBTNode *node)
+{
+    int e = node->heapIndex;
+    if (e < 0)
+    {
+        return;
+    }
+
+    int direction = node->ride.compareTotal(entries[e].key);
+    entries[e].key = node->ride;
+    if (direction == 0)
+    {
+        return;
+    }
+
+    if (direction < 0)
+    {
+        if (e != root)
+        {
+            cut(e);
+            root = meld(root, e);
+        }
+        return;
+    }
+
+    int children = entries[e].child;
+    entries[e].child = -1;
+    if (e == root)
+    {
+        root = meld(mergePairs(children), e);
+    }
+    else
+    {
+        cut(e);
+        root = meld(meld(root, mergePairs(children)), e);
+    }
+}
+
+// peekSmallest function for the Pairing Heap
+// Every entry taken hands all its children to the frontier, so the cost also grows with their
+// number: O(k log k) plus the children of the k entries taken
+inline void PairingHeap::peekSmallest(std::size_t k, std::vector<RBTNode *> &out) const
+{
+    if (root < 0 || k == 0)
+    {
+        return;
+    }
+    std::vector<int> frontier(1, root);
+    auto after = [this](int a, int b) { return less(b, a); };
+    while (k-- && !frontier.empty())
+    {
+        std::pop_heap(frontier.begin(), frontier.end(), after);
+        int e = frontier.back();
+        frontier.pop_back();
+        out.push_back(entries[e].node);
+        for (int child = entries[e].child; child >= 0; child = entries[child].sibling)
+        {
+            frontier.push_back(child);
+            std::push_heap(frontier.begin(), frontier.end(), after);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,94 @@
+// Parallel Print(r1,r2) for wide ranges (--print-threads).
+// A range holding at least minRides rides is cut by rank into equal chunks, a few per thread,
+// each of which starts with an O(log n) select and walks its rides from there (printPage). The
+// chunks are formatted on a work-stealing pool into buffers of their own and written out in
+// order, joined by the same commas the serial walk puts between rides, so the output is byte for
+// byte that of RideIndex::printRange. The pool's threads are kept from one print to the next, so
+// a print pays a wake-up rather than a thread start. Narrower ranges, and every range with one
+// thread, take the serial path. The index is only read, and the caller must not change it while
+// a print runs.
+
+#ifndef GATORTAXI_PARALLELRANGEPRINTER_H
+#define GATORTAXI_PARALLELRANGEPRINTER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OutputWriter.h"
+#include "RideIndex.h"
+#include "WorkStealingPool.h"
+
+class ParallelRangePrinter
+{
+public:
+    static const std::size_t DEFAULT_MIN_RIDES = 1 << 16;
+    // Chunks per thread, so a thread that drew slow chunks is helped out by the others
+    static const std::size_t CHUNKS_PER_THREAD = 4;
+
+    // 0 threads means one per hardware thread
+    explicit ParallelRangePrinter(unsigned threads = 0, std::size_t minRides = DEFAULT_MIN_RIDES) : pool(threads), minRides(minRides) {}
+
+    ParallelRangePrinter(const ParallelRangePrinter &) = delete;
+    ParallelRangePrinter &operator=(const ParallelRangePrinter &) = delete;
+
+    void printRange(RideIndex &rides, int rideNumber1, int rideNumber2, OutputWriter &outputFile)
+    {
+        std::size_t count = pool.threadCount() > 1 ? rides.count(rideNumber1, rideNumber2) : 0;
+        if (count < minRides || count < 2)
+        {
+            rides.printRange(rideNumber1, rideNumber2, outputFile);
+            return;
+        }
+
+        std::size_t chunks = pool.threadCount() * CHUNKS_PER_THREAD;
+        if (chunks > count)
+        {
+            chunks = count;
+        }
+        while (buffers.size() < chunks)
+        {
+            buffers.push_back(std::unique_ptr<Chunk>(new Chunk()));
+        }
+        pool.run(chunks, [&](std::size_t chunk, std::size_t)
+                 {
+                     // Chunk i holds the rides of ranks [count * i / chunks, count * (i + 1) / chunks) within the range
+                     std::size_t first = count * chunk / chunks;
+                     std::size_t last = count * (chunk + 1) / chunks;
+                     Chunk &buffer = *buffers[chunk];
+                     buffer.text.clear();
+                     buffer.writer.openString(buffer.text);
+                     rides.printPage(rideNumber1, rideNumber2, first, last - first, buffer.writer);
+                     buffer.writer.close();
+                 });
+
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            if (chunk)
+                outputFile.put(',');
+            outputFile.write(buffers[chunk]->text.data(), buffers[chunk]->text.size());
+        }
+        ++parallelPrints;
+    }
+
+    unsigned threadCount() const { return pool.threadCount(); }
+    // Prints that took the parallel path
+    std::size_t parallelCount() const { return parallelPrints; }
+
+private:
+    struct Chunk
+    {
+        Chunk() : writer(64 * 1024) {}
+
+        std::string text;
+        OutputWriter writer;
+    };
+
+    WorkStealingPool pool;
+    std::size_t minRides;
+    std::vector<std::unique_ptr<Chunk> > buffers;
+    std::size_t parallelPrints = 0;
+};
+
+#endif
@@ -0,0 +1,37 @@
+// Red-Black Tree node. Each node also remembers its slot in the Min Heap so the
+// heap can remove or re-order a ride without searching for it, and the number of nodes in its
+// subtree so the tree can count and index rides by rank in O(log n). Templated on the ride
+// number type like BasicRide; RBTNode holds a Ride.
+
+#ifndef GATORTAXI_RBTNODE_H
+#define GATORTAXI_RBTNODE_H
+
+#include "Ride.h"
+
+enum Color
+{
+    RED,
+    BLACK
+};
+
+template <class Key>
+class BasicRBTNode
+{
+public:
+    typedef Key KeyType;
+    typedef BasicRide<Key> RideType;
+
+    RideType ride;
+    int size = 1; // nodes in the subtree rooted here; fills the padding after an int ride
+    BasicRBTNode *left;
+    BasicRBTNode *right;
+    BasicRBTNode *parent;
+    Color color;
+    int heapIndex = -1; // -1 when the ride is not in the Min Heap
+
+    BasicRBTNode(RideType ride, BasicRBTNode *parent, BasicRBTNode *left, BasicRBTNode *right, Color color) : ride(ride), left(left), right(right), parent(parent), color(color) {}
+};
+
+typedef BasicRBTNode<int> RBTNode;
+
+#endif
@@ -0,0 +1,103 @@
+// Slab arena for Red-Black Tree nodes.
+// Nodes are carved out of large slabs and recycled through an intrusive free list threaded
+// through the parent pointer of released nodes, so insert/cancel churn never reaches the
+// global allocator and live nodes stay packed together. Dropping a whole tree frees the
+// slabs without visiting a single node.
+// Building with -DGATORTAXI_MALLOC_NODES falls back to one new/delete per node, which is
+// only kept around to benchmark the arena against. The arena is templated on the node type, one
+// per ride number width; RBTNodeArena hands out RBTNodes.
+
+#ifndef GATORTAXI_RBTNODEARENA_H
+#define GATORTAXI_RBTNODEARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "RBTNode.h"
+
+template <class Node>
+class BasicNodeArena
+{
+public:
+#ifdef GATORTAXI_MALLOC_NODES
+    static const bool bulkRelease = false;
+#else
+    static const bool bulkRelease = true;
+#endif
+
+    BasicNodeArena() : freeList(nullptr), slabUsed(SLAB_NODES), liveNodes(0) {}
+
+    ~BasicNodeArena() { releaseAll(); }
+
+    BasicNodeArena(const BasicNodeArena &) = delete;
+    BasicNodeArena &operator=(const BasicNodeArena &) = delete;
+
+    Node *allocate(const typename Node::RideType &ride, Color color)
+    {
+        ++liveNodes;
+#ifdef GATORTAXI_MALLOC_NODES
+        return new Node(ride, nullptr, nullptr, nullptr, color);
+#else
+        void *slot;
+        if (freeList)
+        {
+            slot = freeList;
+            freeList = freeList->parent;
+        }
+        else
+        {
+            if (slabUsed == SLAB_NODES)
+            {
+                slabs.push_back(static_cast<Node *>(::operator new(SLAB_NODES * sizeof(Node))));
+                slabUsed = 0;
+            }
+            slot = slabs.back() + slabUsed++;
+        }
+        return new (slot) Node(ride, nullptr, nullptr, nullptr, color);
+#endif
+    }
+
+    void release(Node *node)
+    {
+        --liveNodes;
+#ifdef GATORTAXI_MALLOC_NODES
+        delete node;
+#else
+        node->parent = freeList;
+        freeList = node;
+#endif
+    }
+
+    // Frees every node at once; with GATORTAXI_MALLOC_NODES the owner must release nodes itself
+    void releaseAll()
+    {
+        for (Node *slab : slabs)
+        {
+            ::operator delete(slab);
+        }
+        slabs.clear();
+        freeList = nullptr;
+        slabUsed = SLAB_NODES;
+        liveNodes = 0;
+    }
+
+    std::size_t size() const { return liveNodes; }
+    std::size_t reservedBytes() const { return slabs.size() * SLAB_NODES * sizeof(Node); }
+
+private:
+    // 4096 nodes per slab keeps a slab around 200KB, large enough that slab allocation is rare
+    static const std::size_t SLAB_NODES = 4096;
+
+    static_assert(std::is_trivially_destructible<Node>::value, "arena frees nodes without running destructors");
+
+    std::vector<Node *> slabs;
+    Node *freeList;
+    std::size_t slabUsed;
+    std::size_t liveNodes;
+};
+
+typedef BasicNodeArena<RBTNode> RBTNodeArena;
+
+#endif
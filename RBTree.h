@@ -0,0 +1,977 @@
+// Red-Black Tree class for storing the rides in order of ride number, the default RideIndex
+// The last inserted node is kept as a finger while it holds the largest ride number, so a feed
+// of ascending ride numbers hangs each new node right below it without searching from the root.
+// BasicRBTree is templated on the ride number type; RBTree, with int ride numbers, is the index
+// gatorTaxi runs on, and BasicRBTree<long long> keeps 64-bit ride numbers.
+
+#ifndef GATORTAXI_RBTREE_H
+#define GATORTAXI_RBTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "OutputWriter.h"
+#include "RBTNode.h"
+#include "RBTNodeArena.h"
+#include "RideIndex.h"
+#include "RideQueue.h"
+#include "Stats.h"
+
+template <class Key>
+class BasicRBTree final : public BasicRideIndex<Key>
+{
+    typedef BasicRideIndex<Key> Base;
+
+public:
+    typedef typename Base::RideType RideType;
+    typedef typename Base::Node Node;
+
+    Node *root;
+
+    // heapReserve is only the initial reservation, the heap grows past it on demand;
+    // queueKind picks the priority queue backend
+    BasicRBTree(std::size_t heapReserve = 100, QueueKind queueKind = QUEUE_BINARY, bool rideNumberTies = false) : Base(heapReserve, queueKind, rideNumberTies)
+    {
+        root = nullptr;
+        finger = nullptr;
+    }
+
+    ~BasicRBTree()
+    {
+        // The arena frees all nodes in bulk, only per-node allocation needs a walk
+        if (!BasicNodeArena<Node>::bulkRelease)
+        {
+            deleteTree(root);
+        }
+    }
+
+    using Base::minHeap;
+    using Base::hashIndex;
+    using Base::printRange;
+
+    void insert(RideType ride) override
+    {
+        Node *newNode = nodes.allocate(ride, RED);
+        insert(newNode);
+        hashInsert(newNode);
+        minHeap->insert(newNode);
+    }
+
+    bool tryInsert(RideType ride) override
+    {
+        Node *parent;
+        bool largest;
+        if (findSlot(ride.rideNumber, parent, largest))
+        {
+            return false;
+        }
+        Node *newNode = nodes.allocate(ride, RED);
+        link(newNode, parent, largest);
+        hashInsert(newNode);
+        minHeap->insert(newNode);
+        return true;
+    }
+
+    Node *search(Key rideNumber) override
+    {
+        if (hashIndex.isEnabled())
+        {
+            return hashIndex.find(rideNumber);
+        }
+        Node *current = root;
+        while (current && current->ride.rideNumber != rideNumber)
+        {
+            if (rideNumber < current->ride.rideNumber)
+            {
+                current = current->left;
+            }
+            else
+            {
+                current = current->right;
+            }
+        }
+        return current;
+    }
+
+    void printRange(Key rideNumber1, Key rideNumber2, OutputWriter &outputFile) override
+    {
+        RangeCursor cursor = range(rideNumber1, rideNumber2);
+        Node *node = cursor.next();
+        if (!node)
+        {
+            outputFile.write("(0,0,0)");
+            return;
+        }
+
+        outputFile.writeRide(node->ride);
+        while ((node = cursor.next()))
+        {
+            outputFile.put(',');
+            outputFile.writeRide(node->ride);
+        }
+    }
+
+    // In-order cursor over the rides with rideNumber1 <= rideNumber <= rideNumber2.
+    // It walks successors through the parent pointers, so a scan of k rides costs O(log n + k)
+    // with no recursion. The cursor is invalidated by any insert or removal.
+    class RangeCursor
+    {
+    public:
+        RangeCursor(Node *first, Key upper) : current(first), upper(upper) {}
+
+        // Returns the next ride in the range, or nullptr once the range is exhausted
+        Node *next()
+        {
+            if (!current || current->ride.rideNumber > upper)
+            {
+                return nullptr;
+            }
+            Node *result = current;
+            current = successor(current);
+            return result;
+        }
+
+    private:
+        Node *current;
+        Key upper;
+    };
+
+    RangeCursor range(Key rideNumber1, Key rideNumber2)
+    {
+        return RangeCursor(lowerBound(rideNumber1), rideNumber2);
+    }
+
+    // First node with rideNumber >= the given one, or nullptr if there is none
+    Node *lowerBound(Key rideNumber)
+    {
+        Node *current = root;
+        Node *candidate = nullptr;
+        while (current)
+        {
+            if (current->ride.rideNumber < rideNumber)
+            {
+                current = current->right;
+            }
+            else
+            {
+                candidate = current;
+                current = current->left;
+            }
+        }
+        return candidate;
+    }
+
+    // Number of rides with a smaller ride number, O(log n)
+    std::size_t rank(Key rideNumber) override
+    {
+        std::size_t smaller = 0;
+        for (Node *current = root; current;)
+        {
+            if (current->ride.rideNumber < rideNumber)
+            {
+                smaller += sizeOf(current->left) + 1;
+                current = current->right;
+            }
+            else
+            {
+                current = current->left;
+            }
+        }
+        return smaller;
+    }
+
+    // Ride at 0-based position index in ride number order, or nullptr past the end, O(log n)
+    Node *select(std::size_t index) override
+    {
+        Node *current = root;
+        while (current)
+        {
+            std::size_t leftSize = sizeOf(current->left);
+            if (index < leftSize)
+            {
+                current = current->left;
+            }
+            else if (index == leftSize)
+            {
+                return current;
+            }
+            else
+            {
+                index -= leftSize + 1;
+                current = current->right;
+            }
+        }
+        return nullptr;
+    }
+
+    void printPage(Key rideNumber1, Key rideNumber2, std::size_t offset, std::size_t limit, OutputWriter &outputFile) override
+    {
+        Node *node = limit ? select(rank(rideNumber1) + offset) : nullptr;
+        if (!node || node->ride.rideNumber > rideNumber2)
+        {
+            outputFile.write("(0,0,0)");
+            return;
+        }
+
+        outputFile.writeRide(node->ride);
+        while (--limit && (node = successor(node)) && node->ride.rideNumber <= rideNumber2)
+        {
+            outputFile.put(',');
+            outputFile.writeRide(node->ride);
+        }
+    }
+
+    // In-order successor of node, or nullptr if node holds the largest ride number
+    static Node *successor(Node *node)
+    {
+        if (node->right)
+        {
+            node = node->right;
+            while (node->left)
+            {
+                node = node->left;
+            }
+            return node;
+        }
+        while (node->parent && node == node->parent->right)
+        {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    void removeNode(Node *node) override
+    {
+        minHeap->remove(node);
+        hashErase(node->ride.rideNumber);
+        if (node == finger)
+            finger = nullptr;
+
+        Node *y = node;
+        Color yOriginalColor = y->color;
+        Node *x = nullptr; // Initialize x to nullptr to avoid uninitialized usage later
+        Node *xParent = nullptr; // Parent of x, needed by the fixup when x is a null leaf
+
+        // Every subtree above the node that is unlinked loses one ride; with two children that
+        // is the successor, which then takes over node's place and its (updated) size
+        Node *unlinked = node->left && node->right ? minimum(node->right) : node;
+        for (Node *above = unlinked->parent; above; above = above->parent)
+        {
+            --above->size;
+        }
+
+        // If node has no left child, replace node with its right child
+        if (!node->left)
+        {
+            x = node->right;
+            xParent = node->parent;
+            transplant(node, node->right);
+        } // If node has no right child, replace node with its left child
+        else if (!node->right)
+        {
+            x = node->left;
+            xParent = node->parent;
+            transplant(node, node->left);
+        } // If node has both left and right children, replace node with its successor
+        else
+        {
+            y = unlinked;
+            yOriginalColor = y->color;
+            x = y->right;
+            // If successor is a direct child of node, replace successor with its right child
+            if (y->parent == node)
+            {
+                xParent = y;
+                if (x)
+                    x->parent = y;
+            }
+            // If successor is not a direct child of node, replace successor with its right child and replace successor's parent with successor's right child
+            else
+            {
+                xParent = y->parent;
+                transplant(y, y->right);
+                y->right = node->right;
+                y->right->parent = y;
+            }
+            // Replace node with successor
+            transplant(node, y);
+            y->left = node->left;
+            y->left->parent = y;
+            y->color = node->color;
+            y->size = node->size;
+        }
+
+        // If successor is black, fix the tree
+        if (yOriginalColor == BLACK)
+        {
+            removeFixup(x, xParent);
+        }
+        nodes.release(node);
+    }
+
+    // A batch of at least size() / BATCH_REBUILD_FRACTION rides is removed by relinking the
+    // remaining nodes into a balanced tree in O(n); smaller batches are removed one by one
+    void removeExtracted(std::vector<Node *> &extracted) override
+    {
+        if (extracted.size() < size() / BATCH_REBUILD_FRACTION)
+        {
+            for (Node *node : extracted)
+            {
+                removeNode(node);
+            }
+            return;
+        }
+
+        // Extracted rides are the ones no longer in the heap
+        std::vector<Node *> kept;
+        kept.reserve(size() - extracted.size());
+        RangeCursor cursor = range(std::numeric_limits<Key>::min(), std::numeric_limits<Key>::max());
+        while (Node *node = cursor.next())
+        {
+            if (minHeap->contains(node))
+                kept.push_back(node);
+        }
+        for (Node *node : extracted)
+        {
+            hashErase(node->ride.rideNumber);
+            nodes.release(node);
+        }
+        root = relinkBalanced(kept);
+        finger = nullptr;
+    }
+
+    // Bulk-loads rides sorted by strictly ascending ride number that all come after the largest
+    // ride number already in the tree. The new rides are built into a balanced red-black subtree
+    // in O(k), joined to the tree in O(log n), and heapified together. Returns false without
+    // touching anything if the rides do not come after the current maximum.
+    bool appendSorted(const RideType *rides, std::size_t count) override
+    {
+        if (count == 0)
+        {
+            return true;
+        }
+        if (root && maximum(root)->ride.rideNumber >= rides[0].rideNumber)
+        {
+            return false;
+        }
+
+        std::vector<Node *> added;
+        added.reserve(count);
+
+        if (!root)
+        {
+            root = buildBalanced(rides, 0, static_cast<int>(count), added);
+        }
+        else
+        {
+            // The first ride becomes the join key between the existing tree and the new subtree
+            Node *joinNode = nodes.allocate(rides[0], RED);
+            added.push_back(joinNode);
+            Node *subtree = buildBalanced(rides, 1, static_cast<int>(count) - 1, added);
+            if (subtree)
+            {
+                join(joinNode, subtree);
+                finger = nullptr;
+            }
+            else
+            {
+                insert(joinNode);
+            }
+        }
+
+        for (Node *node : added)
+        {
+            hashInsert(node);
+        }
+        minHeap->insertAll(added);
+        return true;
+    }
+
+    using Base::appendSorted;
+
+    void collectSorted(std::vector<RideType> &out) override
+    {
+        RangeCursor cursor = range(std::numeric_limits<Key>::min(), std::numeric_limits<Key>::max());
+        while (Node *node = cursor.next())
+        {
+            out.push_back(node->ride);
+        }
+    }
+
+    void collectNodes(std::vector<Node *> &out) override
+    {
+        RangeCursor cursor = range(std::numeric_limits<Key>::min(), std::numeric_limits<Key>::max());
+        while (Node *node = cursor.next())
+        {
+            out.push_back(node);
+        }
+    }
+
+    std::size_t size() const override { return nodes.size(); }
+
+    // Number of nodes on the longest root-to-leaf path, O(n); only meant for reporting
+    int height() const override
+    {
+        int best = 0;
+        std::vector<std::pair<const Node *, int> > pending;
+        if (root)
+            pending.push_back(std::make_pair(root, 1));
+        while (!pending.empty())
+        {
+            const Node *node = pending.back().first;
+            int depth = pending.back().second;
+            pending.pop_back();
+            if (depth > best)
+                best = depth;
+            if (node->left)
+                pending.push_back(std::make_pair(node->left, depth + 1));
+            if (node->right)
+                pending.push_back(std::make_pair(node->right, depth + 1));
+        }
+        return best;
+    }
+
+private:
+    static const std::size_t BATCH_REBUILD_FRACTION = 16;
+
+    using Base::hashInsert;
+    using Base::hashErase;
+#ifdef GATORTAXI_STATS
+    using Base::insertRotations;
+    using Base::removeRotations;
+#endif
+
+    BasicNodeArena<Node> nodes;
+    // Last inserted node while it holds the largest ride number, nullptr otherwise
+    Node *finger;
+#ifdef GATORTAXI_STATS
+    std::uint64_t rotations = 0;
+#endif
+
+    // The ride number must not be in the tree yet
+    void insert(Node *newNode)
+    {
+        Node *parent;
+        bool largest;
+        findSlot(newNode->ride.rideNumber, parent, largest);
+        link(newNode, parent, largest);
+    }
+
+    // Looks for rideNumber and returns its node if it is in the tree, changing nothing; otherwise
+    // returns nullptr with parent set to the node a new one hangs below (nullptr in an empty tree),
+    // largest telling whether it would hold the largest ride number, and the subtree sizes on the
+    // way already counting it, so link must follow
+    Node *findSlot(Key rideNumber, Node *&parent, bool &largest)
+    {
+        // The finger has no right child, being the maximum; its ancestors are the right spine,
+        // which the previous insert has just walked
+        if (finger && rideNumber > finger->ride.rideNumber)
+        {
+            parent = finger;
+            largest = true;
+            for (Node *above = finger; above; above = above->parent)
+            {
+                ++above->size;
+            }
+            return nullptr;
+        }
+
+        Node *current = root;
+        parent = nullptr;
+        largest = true;
+        while (current)
+        {
+            if (rideNumber == current->ride.rideNumber)
+            {
+                for (Node *above = parent; above; above = above->parent)
+                {
+                    --above->size;
+                }
+                return current;
+            }
+            parent = current;
+            ++current->size;
+            if (rideNumber < current->ride.rideNumber)
+            {
+                largest = false;
+                current = current->left;
+            }
+            else
+            {
+                current = current->right;
+            }
+        }
+        return nullptr;
+    }
+
+    // Hangs newNode below parent as found by findSlot and rebalances
+    void link(Node *newNode, Node *parent, bool largest)
+    {
+        newNode->parent = parent;
+        newNode->size = 1;
+
+        if (!parent)
+        {
+            root = newNode;
+        }
+        else if (newNode->ride.rideNumber < parent->ride.rideNumber)
+        {
+            parent->left = newNode;
+        }
+        else
+        {
+            parent->right = newNode;
+        }
+        finger = largest ? newNode : nullptr;
+
+        // Fix Red-Black Tree properties
+        newNode->color = RED;
+
+        insertFixup(newNode);
+    }
+
+    void insertFixup(Node *node)
+    {
+        GATORTAXI_STAT(std::uint64_t rotationsBefore = rotations;)
+        // If node is root, color it black and return
+        while (node->parent && node->parent->color == RED)
+        {
+            // If parent of node is left child of grandparent of node
+            if (node->parent == node->parent->parent->left)
+            {
+                Node *uncle = node->parent->parent->right;
+
+                // If uncle of node is red, recolor parent, uncle and grandparent of node
+                if (uncle && uncle->color == RED)
+                {
+                    node->parent->color = BLACK;
+                    uncle->color = BLACK;
+                    node->parent->parent->color = RED;
+                    node = node->parent->parent;
+                } // If uncle of node is black, rotate the tree
+                else
+                {
+                    // If node is right child of parent, rotate left at parent
+                    if (node == node->parent->right)
+                    {
+                        node = node->parent;
+                        leftRotate(node);
+                    }
+                    node->parent->color = BLACK;
+                    node->parent->parent->color = RED;
+                    rightRotate(node->parent->parent);
+                }
+            } // If parent of node is right child of grandparent of node
+            else
+            {
+                Node *uncle = node->parent->parent->left;
+
+                // If uncle of node is red, recolor parent, uncle and grandparent of node
+                if (uncle && uncle->color == RED)
+                {
+                    node->parent->color = BLACK;
+                    uncle->color = BLACK;
+                    node->parent->parent->color = RED;
+                    node = node->parent->parent;
+                }
+                else // If uncle of node is black, rotate the tree
+                {
+                    // If node is left child of parent, rotate right at parent
+                    if (node == node->parent->left)
+                    {
+                        node = node->parent;
+                        rightRotate(node);
+                    }
+                    node->parent->color = BLACK;
+                    node->parent->parent->color = RED;
+                    leftRotate(node->parent->parent);
+                }
+            }
+        }
+        root->color = BLACK;
+        GATORTAXI_STAT(insertRotations += rotations - rotationsBefore;)
+    }
+
+    void leftRotate(Node *x)
+    {
+        GATORTAXI_STAT(++rotations;)
+        Node *y = x->right;
+        x->right = y->left;
+
+        if (y->left)
+        {
+            y->left->parent = x;
+        }
+
+        y->parent = x->parent;
+
+        if (!x->parent)
+        {
+            root = y;
+        }
+        else if (x == x->parent->left)
+        {
+            x->parent->left = y;
+        }
+        else
+        {
+            x->parent->right = y;
+        }
+
+        y->left = x;
+        x->parent = y;
+
+        y->size = x->size;
+        resize(x);
+    }
+
+    void rightRotate(Node *y)
+    {
+        GATORTAXI_STAT(++rotations;)
+        Node *x = y->left;
+        y->left = x->right;
+
+        if (x->right)
+        {
+            x->right->parent = y;
+        }
+
+        x->parent = y->parent;
+
+        if (!y->parent)
+        {
+            root = x;
+        }
+        else if (y == y->parent->right)
+        {
+            y->parent->right = x;
+        }
+        else
+        {
+            y->parent->left = x;
+        }
+
+        x->right = y;
+        y->parent = x;
+
+        x->size = y->size;
+        resize(y);
+    }
+
+    void transplant(Node *oldNode, Node *newNode)
+    {
+        if (!oldNode->parent)
+        {
+            root = newNode;
+        }
+        else if (oldNode == oldNode->parent->left)
+        {
+            oldNode->parent->left = newNode;
+        }
+        else
+        {
+            oldNode->parent->right = newNode;
+        }
+
+        if (newNode)
+        {
+            newNode->parent = oldNode->parent;
+        }
+    }
+
+    static int sizeOf(const Node *node) { return node ? node->size : 0; }
+
+    static void resize(Node *node) { node->size = 1 + sizeOf(node->left) + sizeOf(node->right); }
+
+    Node *minimum(Node *node)
+    {
+        while (node->left)
+        {
+            node = node->left;
+        }
+        return node;
+    }
+
+    Node *maximum(Node *node)
+    {
+        while (node->right)
+        {
+            node = node->right;
+        }
+        return node;
+    }
+
+    // Builds a balanced subtree from rides[first, first + count). Splitting at the midpoint keeps
+    // every leaf on the deepest two levels, so coloring the deepest level red and everything
+    // else black gives a valid red-black subtree with a black root. The new nodes are appended
+    // to added in ride number order, the order their Inserts would have queued them in.
+    Node *buildBalanced(const RideType *rides, int first, int count, std::vector<Node *> &added)
+    {
+        int deepest = 0;
+        while ((2 << deepest) <= count)
+        {
+            ++deepest;
+        }
+        return buildBalanced(rides, first, count, 0, deepest, added);
+    }
+
+    Node *buildBalanced(const RideType *rides, int first, int count, int depth, int deepest, std::vector<Node *> &added)
+    {
+        if (count <= 0)
+        {
+            return nullptr;
+        }
+
+        int mid = first + count / 2;
+        Node *node = nodes.allocate(rides[mid], depth == deepest && depth > 0 ? RED : BLACK);
+        node->size = count;
+
+        node->left = buildBalanced(rides, first, mid - first, depth + 1, deepest, added);
+        added.push_back(node);
+        node->right = buildBalanced(rides, mid + 1, first + count - mid - 1, depth + 1, deepest, added);
+        if (node->left)
+            node->left->parent = node;
+        if (node->right)
+            node->right->parent = node;
+        return node;
+    }
+
+    // Relinks nodes sorted by ride number into a balanced subtree colored like buildBalanced
+    Node *relinkBalanced(const std::vector<Node *> &sorted)
+    {
+        int count = static_cast<int>(sorted.size());
+        int deepest = 0;
+        while ((2 << deepest) <= count)
+        {
+            ++deepest;
+        }
+        Node *top = relinkBalanced(sorted, 0, count, 0, deepest);
+        if (top)
+            top->parent = nullptr;
+        return top;
+    }
+
+    Node *relinkBalanced(const std::vector<Node *> &sorted, int first, int count, int depth, int deepest)
+    {
+        if (count <= 0)
+        {
+            return nullptr;
+        }
+
+        int mid = first + count / 2;
+        Node *node = sorted[mid];
+        node->color = depth == deepest && depth > 0 ? RED : BLACK;
+        node->size = count;
+        node->left = relinkBalanced(sorted, first, mid - first, depth + 1, deepest);
+        node->right = relinkBalanced(sorted, mid + 1, first + count - mid - 1, depth + 1, deepest);
+        if (node->left)
+            node->left->parent = node;
+        if (node->right)
+            node->right->parent = node;
+        return node;
+    }
+
+    // Number of black nodes on any path from node down to a leaf
+    static int blackHeight(Node *node)
+    {
+        int height = 0;
+        for (; node; node = node->left)
+        {
+            if (node->color == BLACK)
+                ++height;
+        }
+        return height;
+    }
+
+    // Joins the tree with a subtree whose keys are all larger, using joinNode as the key in
+    // between: joinNode is hung in red where the black heights match, then fixed up as an insert
+    void join(Node *joinNode, Node *subtree)
+    {
+        int leftHeight = blackHeight(root);
+        int rightHeight = blackHeight(subtree);
+        // The spine nodes above joinNode gain the other side and joinNode itself
+        int gained = 1 + (leftHeight >= rightHeight ? subtree->size : root->size);
+
+        if (leftHeight >= rightHeight)
+        {
+            // Walk down the right spine of the tree to a black node of the subtree's black height
+            Node *spine = root;
+            int height = leftHeight;
+            while (spine->color == RED || height > rightHeight)
+            {
+                if (spine->color == BLACK)
+                    --height;
+                spine = spine->right;
+            }
+
+            joinNode->parent = spine->parent;
+            if (!spine->parent)
+                root = joinNode;
+            else
+                spine->parent->right = joinNode;
+            joinNode->left = spine;
+            joinNode->right = subtree;
+        }
+        else
+        {
+            // Walk down the left spine of the subtree to a black node of the tree's black height
+            Node *spine = subtree;
+            int height = rightHeight;
+            while (spine->color == RED || height > leftHeight)
+            {
+                if (spine->color == BLACK)
+                    --height;
+                spine = spine->left;
+            }
+
+            joinNode->parent = spine->parent;
+            joinNode->left = root;
+            joinNode->right = spine;
+            if (!spine->parent)
+            {
+                root = joinNode;
+            }
+            else
+            {
+                spine->parent->left = joinNode;
+                root = subtree;
+            }
+        }
+
+        joinNode->left->parent = joinNode;
+        joinNode->right->parent = joinNode;
+        resize(joinNode);
+        for (Node *above = joinNode->parent; above; above = above->parent)
+        {
+            above->size += gained;
+        }
+        joinNode->color = RED;
+        insertFixup(joinNode);
+    }
+
+    // parent is the parent of node; node may be a null leaf after a removal
+    void removeFixup(Node *node, Node *parent)
+    {
+        GATORTAXI_STAT(std::uint64_t rotationsBefore = rotations;)
+        while (node != root && (!node || node->color == BLACK))
+        {
+            if (node == parent->left)
+            {
+                Node *sibling = parent->right;
+
+                // If sibling is red, recolor sibling and parent of node
+                if (sibling->color == RED)
+                {
+                    sibling->color = BLACK;
+                    parent->color = RED;
+                    leftRotate(parent);
+                    sibling = parent->right;
+                }
+
+                // If sibling is black and both children of sibling are black, recolor sibling
+                if ((!sibling->left || sibling->left->color == BLACK) && (!sibling->right || sibling->right->color == BLACK))
+                {
+                    sibling->color = RED;
+                    node = parent;
+                    parent = node->parent;
+                } // If sibling is black and left child of sibling is red and right child of sibling is black, recolor sibling and left child of sibling
+                else
+                {
+                    // If right child of sibling is black, recolor sibling and left child of sibling
+                    if (!sibling->right || sibling->right->color == BLACK)
+                    {
+                        sibling->left->color = BLACK;
+                        sibling->color = RED;
+                        rightRotate(sibling);
+                        sibling = parent->right;
+                    }
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
+
+                    // If right child of sibling is red, recolor right child of sibling
+                    if (sibling->right)
+                        sibling->right->color = BLACK;
+
+                    // Rotate left at parent of node
+                    leftRotate(parent);
+                    node = root;
+                    parent = nullptr;
+                }
+            }
+            else
+            {
+                Node *sibling = parent->left;
+                if (sibling->color == RED)
+                {
+                    sibling->color = BLACK;
+                    parent->color = RED;
+                    rightRotate(parent);
+                    sibling = parent->left;
+                }
+                if ((!sibling->right || sibling->right->color == BLACK) && (!sibling->left || sibling->left->color == BLACK))
+                {
+                    sibling->color = RED;
+                    node = parent;
+                    parent = node->parent;
+                }
+                else
+                {
+                    if (!sibling->left || sibling->left->color == BLACK)
+                    {
+                        sibling->right->color = BLACK;
+                        sibling->color = RED;
+                        leftRotate(sibling);
+                        sibling = parent->left;
+                    }
+                    sibling->color = parent->color;
+                    parent->color = BLACK;
+                    if (sibling->left)
+                        sibling->left->color = BLACK;
+                    rightRotate(parent);
+                    node = root;
+                    parent = nullptr;
+                }
+            }
+        }
+        if (node)
+            node->color = BLACK;
+        GATORTAXI_STAT(removeRotations += rotations - rotationsBefore;)
+    }
+
+    // Post-order teardown that climbs back up through parent pointers instead of recursing
+    void deleteTree(Node *node)
+    {
+        while (node)
+        {
+            if (node->left)
+            {
+                node = node->left;
+            }
+            else if (node->right)
+            {
+                node = node->right;
+            }
+            else
+            {
+                Node *parent = node->parent;
+                if (parent)
+                {
+                    if (parent->left == node)
+                        parent->left = nullptr;
+                    else
+                        parent->right = nullptr;
+                }
+                nodes.release(node);
+                node = parent;
+            }
+        }
+    }
+
+};
+
+typedef BasicRBTree<int> RBTree;
+
+#endif
@@ -0,0 +1,179 @@
+// Result cache for Print(r1,r2), --range-cache N.
+// Holds the formatted output of up to N ranges, keyed on (r1, r2), so a window that is printed
+// again before anything in it changed is answered with one copy instead of a tree walk and the
+// formatting of every ride. Invalidation is exact: a mutation of ride k drops only the entries
+// with r1 <= k <= r2. The bounds of all entries sit in one compact array that is scanned on each
+// mutation, which is cheap for the few hundred windows a dashboard polls and costs nothing
+// while the cache is empty. When full, the least recently used entry is replaced. A miss is
+// rendered through startRender() into a staging string and kept by finishRender().
+
+#ifndef GATORTAXI_RANGECACHE_H
+#define GATORTAXI_RANGECACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "OutputWriter.h"
+#include "Ride.h"
+
+class RangeCache
+{
+public:
+    // Results longer than this are not kept, so one huge range cannot pin a lot of memory
+    static const std::size_t MAX_ENTRY_BYTES = 1 << 20;
+
+    explicit RangeCache(std::size_t capacity) : capacity(capacity), renderer(64 * 1024), clock(0), hits(0), misses(0), invalidations(0)
+    {
+        bounds.reserve(capacity);
+        entries.reserve(capacity);
+    }
+
+    RangeCache(const RangeCache &) = delete;
+    RangeCache &operator=(const RangeCache &) = delete;
+
+    // Cached output of Print(r1,r2), or nullptr on a miss
+    const std::string *find(int rideNumber1, int rideNumber2)
+    {
+        std::unordered_map<std::uint64_t, std::size_t>::iterator found = slots.find(keyOf(rideNumber1, rideNumber2));
+        if (found == slots.end())
+        {
+            ++misses;
+            return nullptr;
+        }
+        ++hits;
+        Entry &entry = entries[found->second];
+        entry.lastUsed = ++clock;
+        return &entry.bytes;
+    }
+
+    // Writer to render a missed Print(r1,r2) into, up to the matching finishRender
+    OutputWriter &startRender()
+    {
+        staging.clear();
+        renderer.openString(staging);
+        return renderer;
+    }
+
+    // Keeps what was rendered as the result of Print(r1,r2) and returns it
+    const std::string &finishRender(int rideNumber1, int rideNumber2)
+    {
+        renderer.close();
+        if (capacity == 0 || staging.size() > MAX_ENTRY_BYTES)
+        {
+            return staging;
+        }
+        if (entries.size() == capacity)
+        {
+            std::size_t oldest = 0;
+            for (std::size_t slot = 1; slot < entries.size(); ++slot)
+            {
+                if (entries[slot].lastUsed < entries[oldest].lastUsed)
+                    oldest = slot;
+            }
+            erase(oldest);
+        }
+        slots[keyOf(rideNumber1, rideNumber2)] = entries.size();
+        bounds.push_back(Bounds{rideNumber1, rideNumber2});
+        entries.push_back(Entry());
+        entries.back().lastUsed = ++clock;
+        entries.back().bytes.swap(staging);
+        return entries.back().bytes;
+    }
+
+    // Drops the entries whose range holds rideNumber
+    void invalidate(int rideNumber)
+    {
+        for (std::size_t slot = bounds.size(); slot-- > 0;)
+        {
+            if (bounds[slot].low <= rideNumber && rideNumber <= bounds[slot].high)
+            {
+                erase(slot);
+                ++invalidations;
+            }
+        }
+    }
+
+    // Drops the entries whose range holds any of rides[0, count), sorted by ride number
+    void invalidateSorted(const Ride *rides, std::size_t count)
+    {
+        const Ride *end = rides + count;
+        for (std::size_t slot = bounds.size(); slot-- > 0;)
+        {
+            const Ride *first = std::lower_bound(rides, end, bounds[slot].low, [](const Ride &ride, int low) { return ride.rideNumber < low; });
+            if (first != end && first->rideNumber <= bounds[slot].high)
+            {
+                erase(slot);
+                ++invalidations;
+            }
+        }
+    }
+
+    bool isEnabled() const { return capacity != 0; }
+    std::size_t size() const { return entries.size(); }
+    std::uint64_t hitCount() const { return hits; }
+    std::uint64_t missCount() const { return misses; }
+    std::uint64_t invalidationCount() const { return invalidations; }
+
+    void dumpCounters(std::FILE *out) const
+    {
+        std::uint64_t lookups = hits + misses;
+        std::fprintf(out, "range_cache_entries %zu\n", entries.size());
+        std::fprintf(out, "range_cache_hits %llu\n", static_cast<unsigned long long>(hits));
+        std::fprintf(out, "range_cache_misses %llu\n", static_cast<unsigned long long>(misses));
+        std::fprintf(out, "range_cache_hit_rate %.3f\n", lookups ? static_cast<double>(hits) / lookups : 0.0);
+        std::fprintf(out, "range_cache_invalidations %llu\n", static_cast<unsigned long long>(invalidations));
+        std::fflush(out);
+    }
+
+private:
+    struct Bounds
+    {
+        int low;
+        int high;
+    };
+
+    struct Entry
+    {
+        std::uint64_t lastUsed;
+        std::string bytes;
+    };
+
+    std::size_t capacity;
+    std::vector<Bounds> bounds; // parallel to entries, kept apart so invalidation scans 8 bytes an entry
+    std::vector<Entry> entries;
+    std::unordered_map<std::uint64_t, std::size_t> slots;
+    OutputWriter renderer;
+    std::string staging;
+    std::uint64_t clock;
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t invalidations;
+
+    static std::uint64_t keyOf(int rideNumber1, int rideNumber2)
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(rideNumber1)) << 32 | static_cast<std::uint32_t>(rideNumber2);
+    }
+
+    // Moves the last entry into the freed slot
+    void erase(std::size_t slot)
+    {
+        slots.erase(keyOf(bounds[slot].low, bounds[slot].high));
+        std::size_t last = entries.size() - 1;
+        if (slot != last)
+        {
+            bounds[slot] = bounds[last];
+            entries[slot].lastUsed = entries[last].lastUsed;
+            entries[slot].bytes.swap(entries[last].bytes);
+            slots[keyOf(bounds[slot].low, bounds[slot].high)] = slot;
+        }
+        bounds.pop_back();
+        entries.pop_back();
+    }
+};
+
+#endif
@@ -0,0 +1,76 @@
+// Ride class shared by the Min Heap and the Red-Black Tree.
+// The ride number type is a template parameter, so the tree and heap can be built for 64-bit
+// ride numbers as well; Ride, with int ride numbers, is what gatorTaxi runs on. Cost and duration
+// stay int either way.
+
+#ifndef GATORTAXI_RIDE_H
+#define GATORTAXI_RIDE_H
+
+#include <climits>
+
+template <class Key>
+class BasicRide
+{
+public:
+    typedef Key KeyType;
+
+    Key rideNumber = 0;
+    int rideCost = 0;
+    int tripDuration = 0;
+
+    BasicRide(Key rideNumber, int rideCost, int tripDuration) : rideNumber(rideNumber), rideCost(rideCost), tripDuration(tripDuration) {}
+
+    // Overloaded comparison operators
+    // Rides are ordered by cost, then duration; rides equal on both compare equal, so which of
+    // them comes first is left to the queue's layout, as it always has been. Fields are compared
+    // rather than subtracted, since the difference of two large or negative ints can overflow.
+    // Returns -1, 0 or 1.
+    int compareTo(const BasicRide &other) const
+    {
+        if (rideCost != other.rideCost)
+        {
+            return rideCost < other.rideCost ? -1 : 1;
+        }
+        if (tripDuration != other.tripDuration)
+        {
+            return tripDuration < other.tripDuration ? -1 : 1;
+        }
+        return 0;
+    }
+
+    // compareTo with equal rides ordered by ride number, the total order used by the alternative
+    // queues and by --ride-number-ties, where the next ride must not depend on the layout
+    int compareTotal(const BasicRide &other) const
+    {
+        int order = compareTo(other);
+        if (order != 0 || rideNumber == other.rideNumber)
+        {
+            return order;
+        }
+        return rideNumber < other.rideNumber ? -1 : 1;
+    }
+};
+
+typedef BasicRide<int> Ride;
+
+// The UpdateTrip rule, shared by every index: a trip no longer than before is taken as is, one up
+// to twice as long costs 10 more (saturating at INT_MAX), and a longer one cancels the ride, in
+// which case false is returned and nothing changes. Twice the old duration is taken in long long,
+// as it does not fit an int for durations past INT_MAX / 2
+inline bool applyTripUpdate(int &rideCost, int &tripDuration, int newTripDuration)
+{
+    if (newTripDuration <= tripDuration)
+    {
+        tripDuration = newTripDuration;
+        return true;
+    }
+    if (newTripDuration <= 2LL * tripDuration)
+    {
+        tripDuration = newTripDuration;
+        rideCost = rideCost > INT_MAX - 10 ? INT_MAX : rideCost + 10;
+        return true;
+    }
+    return false;
+}
+
+#endif
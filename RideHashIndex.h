@@ -0,0 +1,179 @@
+// Open-addressing hash index from ride number to tree node (--hash-index).
+// Point lookups (duplicate checks on Insert, CancelRide, UpdateTrip, Print(x)) are answered with
+// one hashed probe into a flat slot array instead of an O(log n) pointer-chasing descent; the
+// tree is still kept for everything ordered. Slots hold the ride number next to the node
+// pointer, so a probe compares keys without touching the node, and the table stays at most half
+// full, so a lookup rarely reads past the cache line it starts in. Linear probing with
+// backward-shift deletion keeps the table free of tombstones under insert/cancel churn.
+// The table doubles when half full and halves once an eighth full, never below its first size.
+// Templated on the node type, keyed by its ride number type; RideHashIndex indexes RBTNodes.
+
+#ifndef GATORTAXI_RIDEHASHINDEX_H
+#define GATORTAXI_RIDEHASHINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "RBTNode.h"
+
+template <class Node>
+class BasicRideHashIndex
+{
+public:
+    typedef typename Node::KeyType Key;
+
+    static const std::size_t MIN_SLOTS = 16;
+
+    BasicRideHashIndex() : used(0), minSlots(MIN_SLOTS), shift(64), enabled(false) {}
+
+    BasicRideHashIndex(const BasicRideHashIndex &) = delete;
+    BasicRideHashIndex &operator=(const BasicRideHashIndex &) = delete;
+
+    // Starts keeping the index, sized for the expected number of rides; it starts out empty
+    void enable(std::size_t expected)
+    {
+        std::size_t size = MIN_SLOTS;
+        while (size < 2 * expected)
+        {
+            size *= 2;
+        }
+        minSlots = size;
+        resize(size);
+        enabled = true;
+    }
+
+    bool isEnabled() const { return enabled; }
+    std::size_t size() const { return used; }
+    std::size_t slotCount() const { return slots.size(); }
+
+    Node *find(Key rideNumber) const
+    {
+        for (std::size_t i = home(rideNumber);; i = (i + 1) & mask)
+        {
+            const Slot &slot = slots[i];
+            if (!slot.node || slot.key == rideNumber)
+            {
+                return slot.node;
+            }
+        }
+    }
+
+    // The ride number must not be in the index yet
+    void insert(Node *node)
+    {
+        if (2 * (used + 1) > slots.size())
+        {
+            resize(2 * slots.size());
+        }
+        place(node->ride.rideNumber, node);
+        ++used;
+    }
+
+    // No-op if the ride number is not in the index
+    void erase(Key rideNumber);
+
+    void clear()
+    {
+        used = 0;
+        resize(minSlots);
+    }
+
+private:
+    // node == nullptr marks a free slot
+    struct Slot
+    {
+        Key key;
+        Node *node;
+    };
+
+    std::vector<Slot> slots;
+    std::size_t mask;
+    std::size_t used;
+    std::size_t minSlots;
+    int shift; // 64 - log2(slots.size())
+    bool enabled;
+
+    // Fibonacci hashing: the top bits of the product spread sequential ride numbers evenly
+    std::size_t home(Key rideNumber) const
+    {
+        typedef typename std::make_unsigned<Key>::type Bits;
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(static_cast<Bits>(rideNumber)) * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+
+    void place(Key rideNumber, Node *node)
+    {
+        std::size_t i = home(rideNumber);
+        while (slots[i].node)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i].key = rideNumber;
+        slots[i].node = node;
+    }
+
+    void resize(std::size_t size);
+};
+
+typedef BasicRideHashIndex<RBTNode> RideHashIndex;
+
+// erase function for the Ride Hash Index
+// Later entries of the probe run are shifted back into the hole unless that would move them in
+// front of their home slot, so every remaining key stays reachable without tombstones
+template <class Node>
+inline void BasicRideHashIndex<Node>::erase(Key rideNumber)
+{
+    std::size_t hole = home(rideNumber);
+    while (slots[hole].node && slots[hole].key != rideNumber)
+    {
+        hole = (hole + 1) & mask;
+    }
+    if (!slots[hole].node)
+    {
+        return;
+    }
+
+    for (std::size_t next = (hole + 1) & mask; slots[next].node; next = (next + 1) & mask)
+    {
+        // Distances are taken modulo the table size, so the run may wrap around the end
+        std::size_t wanted = home(slots[next].key);
+        if (((next - wanted) & mask) >= ((next - hole) & mask))
+        {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+    }
+    slots[hole].node = nullptr;
+    --used;
+
+    if (slots.size() > minSlots && 8 * used < slots.size())
+    {
+        resize(slots.size() / 2);
+    }
+}
+
+// resize function for the Ride Hash Index, rehashes every entry into a table of the given size
+template <class Node>
+inline void BasicRideHashIndex<Node>::resize(std::size_t size)
+{
+    std::vector<Slot> old;
+    old.swap(slots);
+    Slot empty = {0, nullptr};
+    slots.assign(size, empty);
+    mask = size - 1;
+    shift = 64;
+    for (std::size_t bits = size; bits > 1; bits >>= 1)
+    {
+        --shift;
+    }
+    for (const Slot &slot : old)
+    {
+        if (slot.node)
+        {
+            place(slot.key, slot.node);
+        }
+    }
+}
+
+#endif
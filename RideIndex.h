@@ -0,0 +1,238 @@
+// Ordered index of the pending rides by ride number, with the priority queue that goes with it.
+// Two implementations are selectable at startup: the pointer-based Red-Black Tree and a
+// cache-friendly B+ tree. Both keep every ride in an RBTNode record from a node arena, which is
+// what the priority queue holds, so the command logic below (UpdateTrip, CancelRide, Print of one
+// ride) is written once against search and removeNode. Optionally a hash index from ride number
+// to node answers search in O(1); the implementations keep it in step with every change.
+// The commands that change one ride go through fused operations (tryInsert, updateTrip,
+// cancelRide), each of which finds the ride once and touches the heap once; an implementation
+// that has to descend again to remove what search found overrides them with a single descent.
+// BasicRideIndex is templated on the ride number type; RideIndex, with int ride numbers, is the
+// interface gatorTaxi runs on and the only one the B+ tree implements. The Red-Black Tree is also
+// built for 64-bit ride numbers, with a binary heap as its queue.
+
+#ifndef GATORTAXI_RIDEINDEX_H
+#define GATORTAXI_RIDEINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "BucketQueue.h"
+#include "MinHeap.h"
+#include "OutputWriter.h"
+#include "PackedHeap.h"
+#include "PairingHeap.h"
+#include "RBTNode.h"
+#include "RideHashIndex.h"
+#include "RideQueue.h"
+#include "Stats.h"
+
+enum IndexKind
+{
+    INDEX_RBTREE,
+    INDEX_BTREE
+};
+
+// Maps "rbtree" or "btree" to an IndexKind, returns false for anything else
+inline bool parseIndexKind(const char *name, IndexKind &kind)
+{
+    if (std::strcmp(name, "rbtree") == 0)
+        kind = INDEX_RBTREE;
+    else if (std::strcmp(name, "btree") == 0)
+        kind = INDEX_BTREE;
+    else
+        return false;
+    return true;
+}
+
+inline const char *indexKindName(IndexKind kind)
+{
+    static const char *names[] = {"rbtree", "btree"};
+    return names[kind];
+}
+
+template <class Key>
+class BasicRideIndex
+{
+public:
+    typedef BasicRide<Key> RideType;
+    typedef BasicRBTNode<Key> Node;
+    typedef BasicRideQueue<Node> Queue;
+
+    Queue *minHeap;
+    // Answers search when enabled
+    BasicRideHashIndex<Node> hashIndex;
+
+    // heapReserve is only the initial reservation, the heap grows past it on demand;
+    // queueKind picks the priority queue backend and rideNumberTies its order (see MinHeap.h)
+    BasicRideIndex(std::size_t heapReserve, QueueKind queueKind, bool rideNumberTies) { minHeap = createQueue(queueKind, heapReserve, rideNumberTies); }
+
+    virtual ~BasicRideIndex() { delete minHeap; }
+
+    BasicRideIndex(const BasicRideIndex &) = delete;
+    BasicRideIndex &operator=(const BasicRideIndex &) = delete;
+
+    // New priority queue of the given backend, owned by the caller; only the binary heap has a
+    // choice of tie order, the others always order equal rides by ride number. The other
+    // backends are only built for int ride numbers, wider ones always get the binary heap
+    static Queue *createQueue(QueueKind kind, std::size_t heapReserve, bool rideNumberTies = false)
+    {
+        (void)kind;
+        return new BasicMinHeap<Node, RideOrder, 2>(heapReserve, RideOrder(rideNumberTies));
+    }
+
+    // The ride number must not be in the index yet
+    virtual void insert(RideType ride) = 0;
+    // Inserts the ride unless its ride number is already indexed, in which case nothing changes
+    // and false is returned; the duplicate check is the insert's own descent
+    virtual bool tryInsert(RideType ride) = 0;
+    virtual Node *search(Key rideNumber) = 0;
+    // Writes the rides in the range separated by commas, or (0,0,0) when there are none
+    virtual void printRange(Key rideNumber1, Key rideNumber2, OutputWriter &outputFile) = 0;
+    // Takes the ride out of the index and the heap and frees its record
+    virtual void removeNode(Node *node) = 0;
+    // Takes rides already extracted from the heap out of the index together and frees their
+    // records; extracted may be reordered
+    virtual void removeExtracted(std::vector<Node *> &extracted) = 0;
+    // Bulk-loads rides[0, count) sorted by strictly ascending ride number that all come after the
+    // largest ride number already indexed; returns false without touching anything otherwise
+    virtual bool appendSorted(const RideType *rides, std::size_t count) = 0;
+    // Appends every indexed ride to out in ascending ride number order
+    virtual void collectSorted(std::vector<RideType> &out) = 0;
+    // The same walk, appending the rides' nodes, O(n)
+    virtual void collectNodes(std::vector<Node *> &out) = 0;
+    virtual std::size_t size() const = 0;
+    // Order statistics, all O(log n): the number of rides with a smaller ride number, and the ride
+    // at a 0-based position in ride number order (nullptr past the end)
+    virtual std::size_t rank(Key rideNumber) = 0;
+    virtual Node *select(std::size_t index) = 0;
+    // Like printRange, but skips the first offset rides of the range by rank and writes at most
+    // limit, in O(log n + limit)
+    virtual void printPage(Key rideNumber1, Key rideNumber2, std::size_t offset, std::size_t limit, OutputWriter &outputFile) = 0;
+    // Levels on the longest root-to-leaf path; only meant for reporting
+    virtual int height() const = 0;
+
+#ifdef GATORTAXI_STATS
+    // Rebalancing steps done by inserts and removals: rotations in the Red-Black Tree, node
+    // splits and borrows/merges in the B+ tree
+    std::uint64_t insertRotations = 0;
+    std::uint64_t removeRotations = 0;
+#endif
+
+    bool appendSorted(const std::vector<RideType> &rides) { return appendSorted(rides.data(), rides.size()); }
+
+    // Starts answering search from the hash index, sized for expected rides; the rides already
+    // indexed are added to it in one O(n) walk
+    void enableHashIndex(std::size_t expected)
+    {
+        hashIndex.enable(expected > size() ? expected : size());
+        std::vector<Node *> indexed;
+        indexed.reserve(size());
+        collectNodes(indexed);
+        for (Node *node : indexed)
+        {
+            hashIndex.insert(node);
+        }
+    }
+
+    // Rides with rideNumber1 <= rideNumber <= rideNumber2, O(log n)
+    std::size_t count(Key rideNumber1, Key rideNumber2)
+    {
+        if (rideNumber1 > rideNumber2)
+        {
+            return 0;
+        }
+        std::size_t upTo = rideNumber2 == std::numeric_limits<Key>::max() ? size() : rank(rideNumber2 + 1);
+        return upTo - rank(rideNumber1);
+    }
+
+    void printRange(Key rideNumber, OutputWriter &outputFile)
+    {
+        Node *result = search(rideNumber);
+        if (result)
+        {
+            outputFile.writeRide(result->ride);
+            outputFile.put('\n');
+        }
+        else
+        {
+            outputFile.write("(0,0,0)\n");
+        }
+    }
+
+    void remove(RideType ride) { cancelRide(ride.rideNumber); }
+
+    // Returns false if the ride is not pending
+    virtual bool updateTrip(Key rideNumber, int newTripDuration)
+    {
+        Node *node = search(rideNumber);
+        if (!node)
+            return false;
+
+        if (!updateRide(node, newTripDuration))
+        {
+            removeNode(node);
+        }
+        return true;
+    }
+
+    // Returns false if the ride is not pending
+    virtual bool cancelRide(Key rideNumber)
+    {
+        Node *node = search(rideNumber);
+        if (!node)
+            return false;
+
+        removeNode(node);
+        return true;
+    }
+
+protected:
+    // Applies UpdateTrip to a pending ride and its heap entry; returns false, changing nothing,
+    // when the new trip is too long and the ride has to be cancelled instead
+    bool updateRide(Node *node, int newTripDuration)
+    {
+        if (!applyTripUpdate(node->ride.rideCost, node->ride.tripDuration, newTripDuration))
+        {
+            return false;
+        }
+        minHeap->update(node);
+        return true;
+    }
+
+    void hashInsert(Node *node)
+    {
+        if (hashIndex.isEnabled())
+            hashIndex.insert(node);
+    }
+
+    void hashErase(Key rideNumber)
+    {
+        if (hashIndex.isEnabled())
+            hashIndex.erase(rideNumber);
+    }
+};
+
+typedef BasicRideIndex<int> RideIndex;
+
+// Every backend is available for int ride numbers
+template <>
+inline RideQueue *RideIndex::createQueue(QueueKind kind, std::size_t heapReserve, bool rideNumberTies)
+{
+    switch (kind)
+    {
+    case QUEUE_PAIRING:
+        return new PairingHeap(heapReserve);
+    case QUEUE_BUCKET:
+        return new BucketQueue(heapReserve);
+    case QUEUE_PACKED:
+        return new PackedHeap(heapReserve);
+    default:
+        return new MinHeap(heapReserve, RideOrder(rideNumberTies));
+    }
+}
+
+#endif
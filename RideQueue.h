@@ -0,0 +1,79 @@
+// Priority queue interface for the pending rides, ordered by Ride::compareTo.
+// The ride index owns one queue and talks to it only through this interface, so the backend can
+// be picked at startup: the binary MinHeap, a PairingHeap (O(1) insert and cheap decrease-key),
+// a BucketQueue indexed by ride cost or the 8-ary PackedHeap. Rides equal on cost and duration
+// leave the binary heap in the order its layout gives, exactly as before; the other backends
+// order them by ride number, as the binary heap does with rideNumberTies (--ride-number-ties),
+// so their GetNextRide output is identical to that.
+// Backends record their own handle for a node in RBTNode::heapIndex, -1 while it is not queued.
+// The interface is templated on the node type so that trees with 64-bit ride numbers can have a
+// queue too; only the binary heap is built for those (see RideIndex::createQueue).
+// peekSmallest lists the cheapest rides without popping them: starting from the minimum, it keeps
+// the entries that are only known to be no smaller than something already listed in a small heap
+// of their own, so it looks at O(k) entries instead of the whole queue.
+
+#ifndef GATORTAXI_RIDEQUEUE_H
+#define GATORTAXI_RIDEQUEUE_H
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "RBTNode.h"
+
+enum QueueKind
+{
+    QUEUE_BINARY,
+    QUEUE_PAIRING,
+    QUEUE_BUCKET,
+    QUEUE_PACKED
+};
+
+template <class Node>
+class BasicRideQueue
+{
+public:
+    virtual ~BasicRideQueue() {}
+
+    virtual bool isEmpty() const = 0;
+    virtual int getSize() const = 0;
+    virtual std::size_t getCapacity() const = 0;
+    virtual Node *getMin() const = 0;
+    bool contains(const Node *node) const { return node->heapIndex >= 0; }
+    virtual void insert(Node *node) = 0;
+    virtual void insertAll(const std::vector<Node *> &nodes) = 0;
+    // Throws std::underflow_error when empty
+    virtual Node *extractMin() = 0;
+    // No-op if the node is not in the queue
+    virtual void remove(Node *node) = 0;
+    // Restores the order after the node's cost or duration changed
+    virtual void update(Node *node) = 0;
+    // Appends the k smallest rides to out in ascending order, leaving the queue as it is
+    virtual void peekSmallest(std::size_t k, std::vector<Node *> &out) const = 0;
+};
+
+typedef BasicRideQueue<RBTNode> RideQueue;
+
+// Maps "binary", "pairing", "bucket" or "packed" to a QueueKind, returns false for anything else
+inline bool parseQueueKind(const char *name, QueueKind &kind)
+{
+    if (std::strcmp(name, "binary") == 0)
+        kind = QUEUE_BINARY;
+    else if (std::strcmp(name, "pairing") == 0)
+        kind = QUEUE_PAIRING;
+    else if (std::strcmp(name, "bucket") == 0)
+        kind = QUEUE_BUCKET;
+    else if (std::strcmp(name, "packed") == 0)
+        kind = QUEUE_PACKED;
+    else
+        return false;
+    return true;
+}
+
+inline const char *queueKindName(QueueKind kind)
+{
+    static const char *names[] = {"binary", "pairing", "bucket", "packed"};
+    return names[kind];
+}
+
+#endif
@@ -0,0 +1,264 @@
+// Thread-safe ride store for many concurrent ingest threads.
+// Rides are partitioned by ride-number range over several shards, each a Red-Black Tree with its
+// own Min Heap behind its own mutex, so commands on different ranges run in parallel. Point
+// commands lock one shard. Print(r1,r2) locks the shards the range overlaps in ascending order
+// and, since the shards are ordered by ride number, concatenating their ranges is the merged
+// result. The global next ride comes from a winner tree over the shard minima, kept up to date
+// as the shards change: after a command, a shard whose cheapest ride is no longer the one it last
+// published replays its path to the root, O(log shards), under a small selector lock, and a
+// command that leaves the minimum alone never touches that lock. GetNextRide reads the winner,
+// locks only the winning shard, checks under the selector lock that it still wins and extracts
+// its minimum, so ingest on the other shards carries on meanwhile. Shards order rides of equal
+// cost and duration by ride number, like the winner tree, which makes the ride handed out
+// exactly the one a single tree with --ride-number-ties would give for the same command order.
+// This is a library component: gatorTaxi runs one command stream at a time through
+// CommandExecutor on a single RideIndex and has no option that uses it. gatorBench shards drives
+// it from several threads, and an embedding program with its own ingest threads can do the same.
+
+#ifndef GATORTAXI_SHARDEDRIDESTORE_H
+#define GATORTAXI_SHARDEDRIDESTORE_H
+
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "OutputWriter.h"
+#include "RBTree.h"
+
+class ShardedRideStore
+{
+public:
+    // Ride numbers 0..maxRideNumber are split evenly over shardCount shards; numbers outside
+    // that span still work and land in the first or last shard
+    ShardedRideStore(int shardCount, int maxRideNumber = INT_MAX)
+    {
+        if (shardCount < 1)
+            shardCount = 1;
+        shardWidth = static_cast<long long>(maxRideNumber) / shardCount + 1;
+        for (int i = 0; i < shardCount; ++i)
+        {
+            shards.push_back(std::unique_ptr<Shard>(new Shard()));
+        }
+        leaves = 1;
+        while (leaves < shardCount)
+        {
+            leaves *= 2;
+        }
+        winners.assign(2 * leaves, -1);
+    }
+
+    int shardCount() const { return static_cast<int>(shards.size()); }
+
+    // Returns false, leaving the store unchanged, if the ride number is already pending
+    bool insert(const Ride &ride)
+    {
+        int index = shardIndex(ride.rideNumber);
+        std::lock_guard<std::mutex> guard(shards[index]->lock);
+        if (!shards[index]->tree.tryInsert(ride))
+        {
+            return false;
+        }
+        publish(index);
+        return true;
+    }
+
+    bool find(int rideNumber, Ride &ride)
+    {
+        Shard &shard = shardFor(rideNumber);
+        std::lock_guard<std::mutex> guard(shard.lock);
+        RBTNode *node = shard.tree.search(rideNumber);
+        if (!node)
+        {
+            return false;
+        }
+        ride = node->ride;
+        return true;
+    }
+
+    void updateTrip(int rideNumber, int newTripDuration)
+    {
+        int index = shardIndex(rideNumber);
+        std::lock_guard<std::mutex> guard(shards[index]->lock);
+        if (shards[index]->tree.updateTrip(rideNumber, newTripDuration))
+        {
+            publish(index);
+        }
+    }
+
+    void cancelRide(int rideNumber)
+    {
+        int index = shardIndex(rideNumber);
+        std::lock_guard<std::mutex> guard(shards[index]->lock);
+        if (shards[index]->tree.cancelRide(rideNumber))
+        {
+            publish(index);
+        }
+    }
+
+    // Appends the rides with rideNumber1 <= rideNumber <= rideNumber2 to rides, in order
+    void collectRange(int rideNumber1, int rideNumber2, std::vector<Ride> &rides)
+    {
+        if (rideNumber1 > rideNumber2)
+        {
+            return;
+        }
+        int first = shardIndex(rideNumber1);
+        int last = shardIndex(rideNumber2);
+
+        std::vector<std::unique_lock<std::mutex> > guards;
+        for (int i = first; i <= last; ++i)
+        {
+            guards.push_back(std::unique_lock<std::mutex>(shards[i]->lock));
+        }
+        for (int i = first; i <= last; ++i)
+        {
+            RBTree::RangeCursor cursor = shards[i]->tree.range(rideNumber1, rideNumber2);
+            for (RBTNode *node = cursor.next(); node; node = cursor.next())
+            {
+                rides.push_back(node->ride);
+            }
+        }
+    }
+
+    // Removes and returns the globally cheapest ride; false when nothing is pending. A ride
+    // inserted by another thread while this runs may or may not be taken into account
+    bool getNextRide(Ride &ride)
+    {
+        while (true)
+        {
+            int winner = currentWinner();
+            if (winner < 0)
+            {
+                return false;
+            }
+            Shard &shard = *shards[winner];
+            std::lock_guard<std::mutex> guard(shard.lock);
+            // Another shard may have published a cheaper ride, or another GetNextRide taken this
+            // one, since the winner was read
+            if (currentWinner() != winner)
+            {
+                continue;
+            }
+            RBTNode *node = shard.tree.minHeap->extractMin();
+            ride = node->ride;
+            shard.tree.removeNode(node);
+            publish(winner);
+            return true;
+        }
+    }
+
+    // Same output as RBTree::printRange for a single ride and for a range
+    void printRange(int rideNumber, OutputWriter &outputFile)
+    {
+        Ride ride(0, 0, 0);
+        find(rideNumber, ride);
+        outputFile.writeRide(ride);
+        outputFile.put('\n');
+    }
+
+    void printRange(int rideNumber1, int rideNumber2, OutputWriter &outputFile)
+    {
+        std::vector<Ride> rides;
+        collectRange(rideNumber1, rideNumber2, rides);
+        if (rides.empty())
+        {
+            outputFile.write("(0,0,0)");
+            return;
+        }
+        for (std::size_t i = 0; i < rides.size(); ++i)
+        {
+            if (i)
+                outputFile.put(',');
+            outputFile.writeRide(rides[i]);
+        }
+    }
+
+    std::size_t size()
+    {
+        std::size_t total = 0;
+        for (const std::unique_ptr<Shard> &shard : shards)
+        {
+            std::lock_guard<std::mutex> guard(shard->lock);
+            total += shard->tree.size();
+        }
+        return total;
+    }
+
+private:
+    struct Shard
+    {
+        std::mutex lock;
+        RBTree tree;
+        // The shard's cheapest ride as the winner tree knows it; written holding both the shard
+        // lock and the selector lock, so either one is enough to read it
+        bool published;
+        Ride minimum;
+
+        Shard() : tree(100, QUEUE_BINARY, true), published(false), minimum(0, 0, 0) {}
+    };
+
+    std::vector<std::unique_ptr<Shard> > shards;
+    long long shardWidth;
+    // Winner tree over the shards' published minima: slot 1 is the root, slot leaves + i the
+    // leaf of shard i, and each slot holds its winning shard or -1 when that subtree is empty
+    std::mutex selector;
+    std::vector<int> winners;
+    int leaves;
+
+    int shardIndex(int rideNumber) const
+    {
+        if (rideNumber < 0)
+            return 0;
+        long long index = rideNumber / shardWidth;
+        return index >= static_cast<long long>(shards.size()) ? static_cast<int>(shards.size()) - 1 : static_cast<int>(index);
+    }
+
+    Shard &shardFor(int rideNumber) { return *shards[shardIndex(rideNumber)]; }
+
+    int currentWinner()
+    {
+        std::lock_guard<std::mutex> guard(selector);
+        return winners[1];
+    }
+
+    // The cheaper of two shards' published minima, skipping -1
+    int better(int a, int b) const
+    {
+        if (a < 0 || b < 0)
+            return a < 0 ? b : a;
+        return shards[b]->minimum.compareTotal(shards[a]->minimum) < 0 ? b : a;
+    }
+
+    static bool sameRide(const Ride &a, const Ride &b)
+    {
+        return a.rideNumber == b.rideNumber && a.rideCost == b.rideCost && a.tripDuration == b.tripDuration;
+    }
+
+    // Brings the winner tree up to date with the shard's cheapest ride. Caller holds the shard
+    // lock, and always takes it before the selector lock
+    void publish(int index)
+    {
+        Shard &shard = *shards[index];
+        RideQueue *queue = shard.tree.minHeap;
+        bool present = !queue->isEmpty();
+        if (present == shard.published && (!present || sameRide(queue->getMin()->ride, shard.minimum)))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(selector);
+        shard.published = present;
+        if (present)
+            shard.minimum = queue->getMin()->ride;
+        int slot = leaves + index;
+        winners[slot] = present ? index : -1;
+        for (slot /= 2; slot >= 1; slot /= 2)
+        {
+            winners[slot] = better(winners[2 * slot], winners[2 * slot + 1]);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,256 @@
+// Binary snapshot of the pending rides, for a fast restart (--snapshot, --restore).
+// An image is a fixed header followed by every ride as three native ints in ascending ride
+// number order. Loading maps the file and hands the rides straight to RideIndex::appendSorted,
+// so the tree is built bottom-up and the heap heapified in O(n) with no parsing and no
+// rebalancing. The header also records how far into the command log and the output file the
+// snapshot was taken, so a restart replays only the commands after it and carries on with the
+// output from the same byte. Images are written to a temporary file, synced and renamed over
+// the old one, so a crash while writing leaves the previous snapshot intact. They are only
+// meant to be read back on the same kind of machine: the header checks the byte order and the
+// ride record size of the writer.
+
+#ifndef GATORTAXI_SNAPSHOT_H
+#define GATORTAXI_SNAPSHOT_H
+
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Ride.h"
+#include "RideIndex.h"
+
+// The ride records are used in place from the mapping
+static_assert(std::is_standard_layout<Ride>::value && sizeof(Ride) == 3 * sizeof(int), "Ride must be three packed ints");
+
+struct SnapshotHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;  // BYTE_ORDER_MARK as the writer stored it
+    std::uint32_t rideSize;   // sizeof(Ride) of the writer
+    std::uint32_t reserved;
+    std::uint64_t rideCount;
+    std::uint64_t inputOffset;  // command log byte just past the last applied command
+    std::uint64_t inputLine;    // lines of the command log consumed up to there
+    std::uint64_t outputOffset; // output bytes written by then
+};
+
+class Snapshot
+{
+public:
+    static const std::uint32_t VERSION = 1;
+    static const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    // Where the command log and the output stood when the snapshot was taken
+    struct Position
+    {
+        std::uint64_t inputOffset;
+        std::uint64_t inputLine;
+        std::uint64_t outputOffset;
+    };
+
+    Snapshot() : mapped(nullptr), mappedSize(0) {}
+
+    ~Snapshot() { close(); }
+
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    // Writes every ride in the index to fileName through fileName.tmp; on failure the previous
+    // image is left as it was and false is returned with error set
+    static bool write(const std::string &fileName, RideIndex &rides, const Position &position, std::string &error)
+    {
+        std::vector<Ride> sorted;
+        sorted.reserve(rides.size());
+        rides.collectSorted(sorted);
+
+        SnapshotHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = VERSION;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.rideSize = sizeof(Ride);
+        header.rideCount = sorted.size();
+        header.inputOffset = position.inputOffset;
+        header.inputLine = position.inputLine;
+        header.outputOffset = position.outputOffset;
+
+        std::string temporary = fileName + ".tmp";
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            error = std::strerror(errno);
+            return false;
+        }
+        bool ok = writeAll(fd, &header, sizeof(header)) && writeAll(fd, sorted.data(), sorted.size() * sizeof(Ride)) && fsync(fd) == 0;
+        if (!ok)
+        {
+            error = std::strerror(errno);
+        }
+        if (::close(fd) != 0 && ok)
+        {
+            error = std::strerror(errno);
+            ok = false;
+        }
+        if (ok && std::rename(temporary.c_str(), fileName.c_str()) != 0)
+        {
+            error = std::strerror(errno);
+            ok = false;
+        }
+        if (!ok)
+        {
+            ::unlink(temporary.c_str());
+        }
+        return ok;
+    }
+
+    // Maps and validates an image; the rides stay valid until close()
+    bool open(const std::string &fileName)
+    {
+        close();
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            error = std::strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            error = std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        if (static_cast<std::size_t>(info.st_size) < sizeof(SnapshotHeader))
+        {
+            error = "file too short for a snapshot header";
+            ::close(fd);
+            return false;
+        }
+
+        void *region = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (region == MAP_FAILED)
+        {
+            error = std::strerror(errno);
+            return false;
+        }
+#ifdef MADV_SEQUENTIAL
+        madvise(region, info.st_size, MADV_SEQUENTIAL);
+#endif
+        mapped = static_cast<const char *>(region);
+        mappedSize = info.st_size;
+
+        if (!validate())
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    const SnapshotHeader &header() const { return *reinterpret_cast<const SnapshotHeader *>(mapped); }
+    const Ride *rides() const { return reinterpret_cast<const Ride *>(mapped + sizeof(SnapshotHeader)); }
+    std::size_t rideCount() const { return static_cast<std::size_t>(header().rideCount); }
+
+    Position position() const
+    {
+        Position result = {header().inputOffset, header().inputLine, header().outputOffset};
+        return result;
+    }
+
+    const std::string &lastError() const { return error; }
+
+    void close()
+    {
+        if (mapped)
+        {
+            munmap(const_cast<char *>(mapped), mappedSize);
+            mapped = nullptr;
+        }
+        mappedSize = 0;
+    }
+
+    // Set by SIGUSR2 once installSignalHandler() has run; the main loop takes a snapshot and clears it
+    static volatile std::sig_atomic_t &requested()
+    {
+        static volatile std::sig_atomic_t flag = 0;
+        return flag;
+    }
+
+    static void installSignalHandler()
+    {
+        requested() = 0;
+#ifdef SIGUSR2
+        std::signal(SIGUSR2, onSignal);
+#endif
+    }
+
+private:
+    const char *mapped;
+    std::size_t mappedSize;
+    std::string error;
+
+    static void onSignal(int) { requested() = 1; }
+
+    static const char *magic() { return "GTSNAP\r\n"; }
+
+    bool validate()
+    {
+        const SnapshotHeader &image = header();
+        if (std::memcmp(image.magic, magic(), sizeof(image.magic)) != 0)
+            error = "not a snapshot file";
+        else if (image.version != VERSION)
+            error = "unsupported snapshot version";
+        else if (image.byteOrder != BYTE_ORDER_MARK || image.rideSize != sizeof(Ride))
+            error = "snapshot was written on an incompatible machine";
+        else if (image.rideCount != (mappedSize - sizeof(SnapshotHeader)) / sizeof(Ride) || (mappedSize - sizeof(SnapshotHeader)) % sizeof(Ride) != 0)
+            error = "snapshot size does not match its ride count";
+        else
+        {
+            // appendSorted relies on the order, so a damaged image must not get that far
+            const Ride *ride = rides();
+            for (std::size_t i = 1; i < rideCount(); ++i)
+            {
+                if (ride[i - 1].rideNumber >= ride[i].rideNumber)
+                {
+                    error = "snapshot rides are out of order";
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    static bool writeAll(int fd, const void *data, std::size_t length)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        while (length)
+        {
+            ssize_t count = ::write(fd, bytes, length);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes += count;
+            length -= count;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,164 @@
+// Bounded single-producer/single-consumer ring buffer.
+// The producer only writes tail and the consumer only writes head, each on its own cache line,
+// so a push or pop that does not have to wait is one acquire load and one release store with no
+// lock. A side that finds the ring full (producer) or empty (consumer) spins briefly and then
+// sleeps on a condition variable; the other side only takes the mutex to wake it when the
+// sleeper has announced itself, so the fast path stays lock-free. close() ends the stream: the
+// consumer drains what is left and then pop() returns false, and push() returns false from then on.
+
+#ifndef GATORTAXI_SPSCRING_H
+#define GATORTAXI_SPSCRING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+template <class T>
+class SpscRing
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(std::size_t capacity) : head(0), tail(0), closed(false), producerWaiting(false), consumerWaiting(false)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+        {
+            size *= 2;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    bool tryPush(const T &value);
+    bool tryPop(T &value);
+    // Waits for room; false once the ring is closed
+    bool push(const T &value);
+    // Waits for an item; false once the ring is closed and drained
+    bool pop(T &value);
+    void close();
+
+    bool isClosed() const { return closed.load(std::memory_order_acquire); }
+
+private:
+    static const int SPINS = 64;
+
+    alignas(64) std::atomic<std::size_t> head; // next slot to pop, written by the consumer
+    alignas(64) std::atomic<std::size_t> tail; // next slot to push, written by the producer
+    alignas(64) std::atomic<bool> closed;
+    std::atomic<bool> producerWaiting;
+    std::atomic<bool> consumerWaiting;
+    std::vector<T> slots;
+    std::size_t mask;
+    std::mutex lock;
+    std::condition_variable wakeup;
+
+    void wake(std::atomic<bool> &waiting)
+    {
+        // Pairs with the store in wait: either the sleeper sees our update or we see its flag
+        if (waiting.load(std::memory_order_seq_cst))
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            wakeup.notify_all();
+        }
+    }
+
+    template <class Ready>
+    void wait(std::atomic<bool> &waiting, Ready ready)
+    {
+        for (int spin = 0; spin < SPINS; ++spin)
+        {
+            if (ready())
+                return;
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        waiting.store(true, std::memory_order_seq_cst);
+        while (!ready())
+        {
+            wakeup.wait(guard);
+        }
+        waiting.store(false, std::memory_order_relaxed);
+    }
+};
+
+// tryPush function for the SPSC Ring, false if the ring is full or closed
+template <class T>
+inline bool SpscRing<T>::tryPush(const T &value)
+{
+    if (closed.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    std::size_t slot = tail.load(std::memory_order_relaxed);
+    if (slot - head.load(std::memory_order_acquire) > mask)
+    {
+        return false;
+    }
+    slots[slot & mask] = value;
+    tail.store(slot + 1, std::memory_order_seq_cst);
+    wake(consumerWaiting);
+    return true;
+}
+
+// tryPop function for the SPSC Ring, false if the ring is empty
+template <class T>
+inline bool SpscRing<T>::tryPop(T &value)
+{
+    std::size_t slot = head.load(std::memory_order_relaxed);
+    if (slot == tail.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+    value = slots[slot & mask];
+    head.store(slot + 1, std::memory_order_seq_cst);
+    wake(producerWaiting);
+    return true;
+}
+
+// push function for the SPSC Ring
+template <class T>
+inline bool SpscRing<T>::push(const T &value)
+{
+    while (!tryPush(value))
+    {
+        if (isClosed())
+        {
+            return false;
+        }
+        wait(producerWaiting, [this]() { return isClosed() || tail.load(std::memory_order_relaxed) - head.load(std::memory_order_seq_cst) <= mask; });
+    }
+    return true;
+}
+
+// pop function for the SPSC Ring
+template <class T>
+inline bool SpscRing<T>::pop(T &value)
+{
+    while (!tryPop(value))
+    {
+        if (isClosed())
+        {
+            // Items pushed before close() are still handed out
+            return tryPop(value);
+        }
+        wait(consumerWaiting, [this]() { return isClosed() || head.load(std::memory_order_relaxed) != tail.load(std::memory_order_seq_cst); });
+    }
+    return true;
+}
+
+// close function for the SPSC Ring, may be called from either side
+template <class T>
+inline void SpscRing<T>::close()
+{
+    closed.store(true, std::memory_order_seq_cst);
+    std::lock_guard<std::mutex> guard(lock);
+    wakeup.notify_all();
+}
+
+#endif
@@ -0,0 +1,178 @@
+// Optional runtime statistics, compiled in with -DGATORTAXI_STATS (make gatorTaxiStats).
+// Without the flag every GATORTAXI_STAT(...) statement disappears and nothing here is used,
+// so the normal build pays nothing. With it, each command type gets a count and a log-linear
+// (HDR-style) latency histogram, and the dispatcher tracks the heap size; the tree counts the
+// rotations done by its fixups. The report goes to stderr or a stats file at exit, and
+// whenever the process receives SIGUSR1.
+
+#ifndef GATORTAXI_STATS_H
+#define GATORTAXI_STATS_H
+
+#ifdef GATORTAXI_STATS
+#define GATORTAXI_STAT(statement) statement
+#else
+#define GATORTAXI_STAT(statement)
+#endif
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Latency histogram with 32 linear sub-buckets per power of two: values below 64 are exact and
+// larger values are kept within about 3%, over the whole 64-bit range, in under 2000 counters
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() : counts(BUCKETS, 0), total(0), sum(0), maxValue(0) {}
+
+    void record(std::uint64_t value, std::uint64_t times = 1)
+    {
+        counts[bucketOf(value)] += times;
+        total += times;
+        sum += value * times;
+        if (value > maxValue)
+            maxValue = value;
+    }
+
+    std::uint64_t count() const { return total; }
+    std::uint64_t max() const { return maxValue; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    // Smallest bucket value at or below which a share q of the samples fall
+    std::uint64_t percentile(double q) const
+    {
+        if (!total)
+            return 0;
+        std::uint64_t rank = static_cast<std::uint64_t>(q * (total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t bucket = 0; bucket < counts.size(); ++bucket)
+        {
+            seen += counts[bucket];
+            if (seen >= rank)
+                return valueOf(bucket);
+        }
+        return maxValue;
+    }
+
+private:
+    static const int SUB_BUCKET_BITS = 5;
+    static const std::size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    std::vector<std::uint64_t> counts;
+    std::uint64_t total;
+    std::uint64_t sum;
+    std::uint64_t maxValue;
+
+    static std::size_t bucketOf(std::uint64_t value)
+    {
+        if (value < (2u << SUB_BUCKET_BITS))
+            return static_cast<std::size_t>(value);
+        int shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+        return (static_cast<std::size_t>(shift) << SUB_BUCKET_BITS) + static_cast<std::size_t>(value >> shift);
+    }
+
+    static std::uint64_t valueOf(std::size_t bucket)
+    {
+        if (bucket < (2u << SUB_BUCKET_BITS))
+            return bucket;
+        int shift = static_cast<int>(bucket >> SUB_BUCKET_BITS) - 1;
+        return static_cast<std::uint64_t>(bucket - (static_cast<std::size_t>(shift) << SUB_BUCKET_BITS)) << shift;
+    }
+};
+
+enum StatKind
+{
+    STAT_INSERT,
+    STAT_PRINT,
+    STAT_PRINT_RANGE,
+    STAT_UPDATE_TRIP,
+    STAT_GET_NEXT_RIDE,
+    STAT_CANCEL_RIDE,
+    STAT_ORDER_QUERY, // Count, Rank and Select
+    STAT_PEEK_NEXT_RIDES,
+    STAT_GET_NEXT_RIDES,
+    STAT_KINDS
+};
+
+class RuntimeStats
+{
+public:
+    LatencyHistogram latency[STAT_KINDS];
+    std::uint64_t heapSize = 0;
+    std::uint64_t peakHeapSize = 0;
+
+    void observeHeapSize(std::uint64_t size)
+    {
+        heapSize = size;
+        if (size > peakHeapSize)
+            peakHeapSize = size;
+    }
+
+    // Writes the report; the tree figures are passed in since the tree owns them
+    void dump(std::FILE *out, std::uint64_t treeSize, int treeHeight, std::uint64_t insertRotations, std::uint64_t removeRotations) const
+    {
+        static const char *names[STAT_KINDS] = {"Insert", "Print", "PrintRange", "UpdateTrip", "GetNextRide", "CancelRide", "OrderQuery", "PeekNextRides", "GetNextRides"};
+
+        std::fprintf(out, "# gatorTaxi stats\n");
+        std::fprintf(out, "%-12s %12s %10s %10s %10s %10s %10s %12s\n", "command", "count", "mean_ns", "p50_ns", "p90_ns", "p99_ns", "p999_ns", "max_ns");
+        for (int kind = 0; kind < STAT_KINDS; ++kind)
+        {
+            const LatencyHistogram &h = latency[kind];
+            std::fprintf(out, "%-12s %12llu %10.0f %10llu %10llu %10llu %10llu %12llu\n", names[kind],
+                         static_cast<unsigned long long>(h.count()), h.mean(),
+                         static_cast<unsigned long long>(h.percentile(0.5)), static_cast<unsigned long long>(h.percentile(0.9)),
+                         static_cast<unsigned long long>(h.percentile(0.99)), static_cast<unsigned long long>(h.percentile(0.999)),
+                         static_cast<unsigned long long>(h.max()));
+        }
+        std::fprintf(out, "heap_size %llu\n", static_cast<unsigned long long>(heapSize));
+        std::fprintf(out, "heap_size_peak %llu\n", static_cast<unsigned long long>(peakHeapSize));
+        std::fprintf(out, "tree_size %llu\n", static_cast<unsigned long long>(treeSize));
+        std::fprintf(out, "tree_height %d\n", treeHeight);
+        std::fprintf(out, "insert_fixup_rotations %llu\n", static_cast<unsigned long long>(insertRotations));
+        std::fprintf(out, "remove_fixup_rotations %llu\n", static_cast<unsigned long long>(removeRotations));
+        std::fflush(out);
+    }
+
+    // SIGUSR1 only raises this flag; the dispatch loop notices it and dumps between commands
+    static volatile std::sig_atomic_t &dumpRequested()
+    {
+        static volatile std::sig_atomic_t requested = 0;
+        return requested;
+    }
+
+    static void installSignalHandler()
+    {
+        dumpRequested() = 0; // initialize the flag before a signal can touch it
+#ifdef SIGUSR1
+        std::signal(SIGUSR1, onSignal);
+#endif
+    }
+
+private:
+    static void onSignal(int) { dumpRequested() = 1; }
+};
+
+// Adds the lifetime of a scope to one command type's histogram
+class StatTimer
+{
+public:
+    StatTimer(RuntimeStats *stats, StatKind kind) : stats(stats), kind(kind), start(std::chrono::steady_clock::now()) {}
+
+    ~StatTimer()
+    {
+        if (stats)
+        {
+            std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+            stats->latency[kind].record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+private:
+    RuntimeStats *stats;
+    StatKind kind;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,217 @@
+// Work-stealing thread pool for batches of independent, coarse tasks (gatorTaxi --replay, and
+// the chunks of a wide Print(r1,r2)). Task indices are dealt round-robin onto one deque per
+// worker, so a caller that orders them by expected cost, largest first, gives every worker a
+// similar mix. A worker takes its own tasks from the front; once its deque is empty it steals
+// from the back of the others, where the cheapest tasks sit, so whoever finishes early picks up
+// the tail of a worker that drew long tasks. Tasks are not expected to spawn more tasks, so a
+// worker that finds every deque empty is done with the batch. Each deque has its own lock, which
+// is only ever contended by a steal. The worker threads are started by the first batch and then
+// wait on a condition variable between batches until the pool is destroyed, so a batch costs a
+// wake-up rather than a thread start per worker; the calling thread works as worker 0.
+
+#ifndef GATORTAXI_WORKSTEALINGPOOL_H
+#define GATORTAXI_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool
+{
+public:
+    // 0 threads means one per hardware thread
+    explicit WorkStealingPool(unsigned threads = 0)
+        : threads(threads ? threads : defaultThreads()), steals(0), generation(0), batchWorkers(0), busy(0), stopping(false), task(nullptr), invoke(nullptr)
+    {
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    static unsigned defaultThreads()
+    {
+        unsigned hardware = std::thread::hardware_concurrency();
+        return hardware ? hardware : 1;
+    }
+
+    // Calls task(index, worker) once for every index in [0, count) and returns when all are
+    // done; never uses more workers than there are tasks, and runs a single one inline. One
+    // batch at a time: run must not be called again until it has returned
+    template <class Task>
+    void run(std::size_t count, Task task);
+
+    unsigned threadCount() const { return threads; }
+    std::uint64_t stealCount() const { return steals.load(std::memory_order_relaxed); }
+
+private:
+    // Allocated one by one and padded, so two workers' locks do not share a cache line
+    struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<std::size_t> tasks;
+        char padding[64];
+    };
+
+    unsigned threads;
+    std::atomic<std::uint64_t> steals;
+    std::vector<std::unique_ptr<WorkQueue> > queues;
+    std::vector<std::thread> workers;
+
+    // The current batch, guarded by lock; workers 1..batchWorkers-1 take part in it
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::uint64_t generation;
+    std::size_t batchWorkers;
+    std::size_t busy; // taking part and not done yet, the caller aside
+    bool stopping;
+    void *task;
+    void (*invoke)(void *task, std::size_t index, std::size_t worker);
+
+    template <class Task>
+    static void invokeTask(void *task, std::size_t index, std::size_t worker)
+    {
+        (*static_cast<Task *>(task))(index, worker);
+    }
+
+    static bool take(WorkQueue &queue, bool fromBack, std::size_t &task)
+    {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty())
+        {
+            return false;
+        }
+        if (fromBack)
+        {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+
+    void work(std::size_t self);
+    void workerLoop(std::size_t self, std::uint64_t seen);
+};
+
+// run function for the Work-Stealing Pool
+template <class Task>
+inline void WorkStealingPool::run(std::size_t count, Task task)
+{
+    std::size_t participants = threads < count ? threads : count;
+    if (participants == 0)
+    {
+        return;
+    }
+
+    while (queues.size() < participants)
+    {
+        queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (std::size_t index = 0; index < count; ++index)
+    {
+        queues[index % participants]->tasks.push_back(index);
+    }
+    while (workers.size() + 1 < participants)
+    {
+        // A new worker starts out having seen the batches before this one
+        workers.push_back(std::thread(&WorkStealingPool::workerLoop, this, workers.size() + 1, generation));
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        this->task = &task;
+        invoke = &invokeTask<Task>;
+        batchWorkers = participants;
+        busy = participants - 1;
+        ++generation;
+    }
+    if (participants > 1)
+    {
+        wake.notify_all();
+    }
+    work(0);
+
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [this]() { return busy == 0; });
+}
+
+// work function for the Work-Stealing Pool, runs tasks of the current batch until none is left
+inline void WorkStealingPool::work(std::size_t self)
+{
+    std::size_t index;
+    while (true)
+    {
+        if (take(*queues[self], false, index))
+        {
+            invoke(task, index, self);
+            continue;
+        }
+        // Try the other workers in turn, starting with the next one
+        bool stole = false;
+        for (std::size_t offset = 1; offset < batchWorkers && !stole; ++offset)
+        {
+            stole = take(*queues[(self + offset) % batchWorkers], true, index);
+        }
+        if (!stole)
+        {
+            return;
+        }
+        steals.fetch_add(1, std::memory_order_relaxed);
+        invoke(task, index, self);
+    }
+}
+
+// workerLoop function for the Work-Stealing Pool, one per thread, sleeps between batches
+inline void WorkStealingPool::workerLoop(std::size_t self, std::uint64_t seen)
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&]() { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+            if (self >= batchWorkers)
+            {
+                continue;
+            }
+        }
+        work(self);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (--busy == 0)
+            {
+                finished.notify_one();
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,254 @@
+// Reproducible synthetic workloads for benchmarking.
+// A WorkloadConfig fixes the seed, the size of the pending set to preload, the number and mix of
+// commands, how new ride numbers are drawn and how wide Print ranges are. The generator then
+// yields the same Command sequence every time, either to drive the data structures directly or
+// to be written out as a command file for gatorTaxi.
+
+#ifndef GATORTAXI_WORKLOADGENERATOR_H
+#define GATORTAXI_WORKLOADGENERATOR_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CommandParser.h"
+#include "RideQueue.h"
+
+enum KeyDistribution
+{
+    KEYS_UNIFORM,    // ride numbers scattered over the whole int range
+    KEYS_SEQUENTIAL  // ride numbers handed out in ascending order
+};
+
+class WorkloadConfig
+{
+public:
+    std::uint32_t seed = 1;
+    long preload = 100000;   // rides inserted before the measured commands
+    long operations = 1000000;
+    KeyDistribution keys = KEYS_UNIFORM;
+    int rangeWidth = 100;    // ride numbers covered by Print(r1,r2)
+    double hot = 0.0;        // share of cancels/updates/prints aimed at the newest 1% of rides
+    QueueKind queue = QUEUE_BINARY; // priority queue backend of the tree under test
+
+    // Relative weights of the command types
+    int insertWeight = 30;
+    int printWeight = 10;
+    int printRangeWeight = 5;
+    int updateWeight = 20;
+    int getNextWeight = 15;
+    int cancelWeight = 20;
+
+    // Applies one key=value setting, returns false for an unknown key or bad value
+    bool set(const std::string &key, const std::string &value)
+    {
+        char *end = nullptr;
+        double number = std::strtod(value.c_str(), &end);
+        bool numeric = !value.empty() && *end == '\0' && number >= 0;
+
+        if (key == "keys")
+        {
+            if (value == "uniform")
+                keys = KEYS_UNIFORM;
+            else if (value == "sequential")
+                keys = KEYS_SEQUENTIAL;
+            else
+                return false;
+            return true;
+        }
+        if (key == "queue")
+        {
+            return parseQueueKind(value.c_str(), queue);
+        }
+        if (!numeric)
+        {
+            return false;
+        }
+
+        if (key == "seed")
+            seed = static_cast<std::uint32_t>(number);
+        else if (key == "preload")
+            preload = static_cast<long>(number);
+        else if (key == "ops")
+            operations = static_cast<long>(number);
+        else if (key == "width")
+            rangeWidth = static_cast<int>(number);
+        else if (key == "hot")
+            hot = number;
+        else if (key == "insert")
+            insertWeight = static_cast<int>(number);
+        else if (key == "print")
+            printWeight = static_cast<int>(number);
+        else if (key == "range")
+            printRangeWeight = static_cast<int>(number);
+        else if (key == "update")
+            updateWeight = static_cast<int>(number);
+        else if (key == "next")
+            getNextWeight = static_cast<int>(number);
+        else if (key == "cancel")
+            cancelWeight = static_cast<int>(number);
+        else
+            return false;
+        return true;
+    }
+};
+
+class WorkloadGenerator
+{
+public:
+    WorkloadGenerator(const WorkloadConfig &config) : config(config), rng(config.seed), issued(0), preloaded(0), nextIndex(0)
+    {
+        int weights[] = {config.insertWeight, config.printWeight, config.printRangeWeight, config.updateWeight, config.getNextWeight, config.cancelWeight};
+        int total = 0;
+        for (int weight : weights)
+        {
+            total += weight;
+            cumulativeWeights.push_back(total);
+        }
+    }
+
+    // Yields the next command: the preload Inserts first, then the measured mix.
+    // Returns false once config.operations measured commands have been produced.
+    bool next(Command &command)
+    {
+        if (preloaded < config.preload)
+        {
+            ++preloaded;
+            makeInsert(command);
+            return true;
+        }
+        if (issued >= config.operations || cumulativeWeights.back() == 0)
+        {
+            return false;
+        }
+        ++issued;
+
+        int pick = std::uniform_int_distribution<int>(0, cumulativeWeights.back() - 1)(rng);
+        int kind = 0;
+        while (pick >= cumulativeWeights[kind])
+        {
+            ++kind;
+        }
+
+        // Commands that target an existing ride fall back to an Insert while nothing is pending
+        if (kind != 0 && kind != 4 && live.empty())
+        {
+            kind = 0;
+        }
+
+        command.argCount = 0;
+        switch (kind)
+        {
+        case 0:
+            makeInsert(command);
+            break;
+        case 1:
+            command.type = CMD_PRINT;
+            command.args[0] = pickLive(false);
+            command.argCount = 1;
+            break;
+        case 2:
+            command.type = CMD_PRINT_RANGE;
+            command.args[0] = pickLive(false);
+            command.args[1] = static_cast<int>(std::min<long long>(INT_MAX, static_cast<long long>(command.args[0]) + config.rangeWidth - 1));
+            command.argCount = 2;
+            break;
+        case 3:
+            command.type = CMD_UPDATE_TRIP;
+            command.args[0] = pickLive(false);
+            command.args[1] = durationDistribution(rng);
+            command.argCount = 2;
+            break;
+        case 4:
+            command.type = CMD_GET_NEXT_RIDE;
+            break;
+        default:
+            command.type = CMD_CANCEL_RIDE;
+            command.args[0] = pickLive(true);
+            command.argCount = 1;
+            break;
+        }
+        return true;
+    }
+
+    // Writes the command in the input file syntax, e.g. "Insert(5,50,120)"
+    static std::string format(const Command &command)
+    {
+        static const char *names[] = {"Insert", "Print", "Print", "UpdateTrip", "GetNextRide", "CancelRide"};
+        std::string text = names[command.type];
+        text += '(';
+        for (int i = 0; i < command.argCount; ++i)
+        {
+            if (i)
+                text += ',';
+            text += std::to_string(command.args[i]);
+        }
+        text += ')';
+        return text;
+    }
+
+private:
+    WorkloadConfig config;
+    std::mt19937 rng;
+    long issued;
+    long preloaded;
+    std::uint32_t nextIndex;
+    std::vector<int> cumulativeWeights;
+    // Rides the generator believes are pending; GetNextRide and updates can make entries stale,
+    // which just turns a later command on them into a miss, as in a real feed
+    std::vector<int> live;
+    std::uniform_int_distribution<int> costDistribution{1, 1000};
+    std::uniform_int_distribution<int> durationDistribution{1, 1000};
+
+    // Unique ride numbers: the sequence index itself, or the index scrambled by an odd multiplier,
+    // which is a bijection on 31-bit values and so never repeats within 2^31 inserts
+    int nextRideNumber()
+    {
+        std::uint32_t index = nextIndex++;
+        if (config.keys == KEYS_SEQUENTIAL)
+        {
+            return static_cast<int>(index & 0x7fffffff);
+        }
+        return static_cast<int>((index * 2654435761u) & 0x7fffffff);
+    }
+
+    void makeInsert(Command &command)
+    {
+        command.type = CMD_INSERT;
+        command.args[0] = nextRideNumber();
+        command.args[1] = costDistribution(rng);
+        command.args[2] = durationDistribution(rng);
+        command.argCount = 3;
+        live.push_back(command.args[0]);
+    }
+
+    // A random pending ride, biased to the newest ones by config.hot; remove drops it from the list
+    int pickLive(bool remove)
+    {
+        std::size_t count = live.size();
+        std::size_t index;
+        if (config.hot > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < config.hot)
+        {
+            std::size_t window = count / 100 + 1;
+            index = count - 1 - std::uniform_int_distribution<std::size_t>(0, window - 1)(rng);
+        }
+        else
+        {
+            index = std::uniform_int_distribution<std::size_t>(0, count - 1)(rng);
+        }
+
+        int rideNumber = live[index];
+        if (remove)
+        {
+            live[index] = live.back();
+            live.pop_back();
+        }
+        return rideNumber;
+    }
+};
+
+#endif
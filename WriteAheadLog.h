@@ -0,0 +1,307 @@
+// Append-only write-ahead log of the applied ride mutations (--wal).
+// Every Insert, UpdateTrip, CancelRide and GetNextRide that changed the pending rides is encoded
+// as one fixed 16-byte record. Records are collected in memory and written and synced as a group
+// once the group holds groupBytes bytes or its first record is windowMicros old, so a command
+// pays only a share of one fsync; a window of 0 syncs after every record. The window is checked
+// as records arrive; --serve and --listen also commit whenever their input goes quiet, before
+// the responses are flushed, while without --serve results may reach the output file before the
+// mutations behind them are synced.
+// On open an existing log is replayed record by record through a callback, and a torn or damaged
+// tail (a short record or a checksum mismatch) is cut off before new records are appended. The
+// log holds every mutation since the rides were empty, so it must be replayed into empty rides;
+// a record the rides reject (an Insert of a ride that is already there) fails the open. Nothing
+// records how far into its input a run got, so gatorTaxi only logs commands arriving on a stream
+// that a restarted run does not read again, never a regular command file.
+
+#ifndef GATORTAXI_WRITEAHEADLOG_H
+#define GATORTAXI_WRITEAHEADLOG_H
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CommandParser.h"
+
+// type is the CommandType of the mutation; no mutation takes more than ARGS arguments
+struct WalRecord
+{
+    static const int ARGS = 3;
+
+    std::int32_t args[ARGS];
+    std::uint8_t type;
+    std::uint8_t argCount;
+    std::uint16_t check; // folded FNV-1a hash of the bytes before it
+};
+
+static_assert(sizeof(WalRecord) == 16, "WAL records are 16 bytes");
+
+class WriteAheadLog
+{
+public:
+    static const std::size_t DEFAULT_GROUP_BYTES = 64 * 1024;
+    static const std::uint64_t DEFAULT_WINDOW_MICROS = 2000;
+
+    WriteAheadLog(std::size_t groupBytes = DEFAULT_GROUP_BYTES, std::uint64_t windowMicros = DEFAULT_WINDOW_MICROS)
+        : fd(-1), groupBytes(groupBytes), window(std::chrono::microseconds(windowMicros)), records(0), commits(0)
+    {
+        pending.reserve(groupBytes + sizeof(WalRecord));
+    }
+
+    ~WriteAheadLog() { close(); }
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    // Opens or creates the log; every intact record already in it is handed to apply(const Command &)
+    // in the order it was written, and the count is returned through replayed. apply returns false
+    // when the record cannot be applied, which fails the open with the log left as it was
+    template <class Apply>
+    bool open(const std::string &fileName, Apply apply, std::uint64_t &replayed);
+
+    // Logs one applied mutation; commits the group when it is full or its window has passed
+    void append(const Command &command)
+    {
+        if (fd < 0)
+        {
+            return;
+        }
+        WalRecord record;
+        for (int i = 0; i < WalRecord::ARGS; ++i)
+        {
+            record.args[i] = command.args[i];
+        }
+        record.type = static_cast<std::uint8_t>(command.type);
+        record.argCount = static_cast<std::uint8_t>(command.argCount);
+        record.check = checksum(record);
+
+        if (pending.empty())
+        {
+            groupStart = Clock::now();
+        }
+        const char *bytes = reinterpret_cast<const char *>(&record);
+        pending.insert(pending.end(), bytes, bytes + sizeof(record));
+        ++records;
+        if (pending.size() >= groupBytes || Clock::now() - groupStart >= window)
+        {
+            commit();
+        }
+    }
+
+    void append(CommandType type, int arg0 = 0, int arg1 = 0, int arg2 = 0)
+    {
+        Command command;
+        command.type = type;
+        command.args[0] = arg0;
+        command.args[1] = arg1;
+        command.args[2] = arg2;
+        command.argCount = type == CMD_INSERT ? 3 : type == CMD_UPDATE_TRIP ? 2 : type == CMD_CANCEL_RIDE ? 1 : 0;
+        append(command);
+    }
+
+    // Writes and syncs the current group; false (with lastError set) if the log can no longer be
+    // trusted, after which nothing more is logged
+    bool commit()
+    {
+        if (fd < 0 || pending.empty())
+        {
+            return fd >= 0;
+        }
+        if (!writeAll(pending.data(), pending.size()) || sync(fd) != 0)
+        {
+            error = std::strerror(errno);
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        pending.clear();
+        ++commits;
+        return true;
+    }
+
+    void close()
+    {
+        if (fd < 0)
+        {
+            return;
+        }
+        if (commit())
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    bool isOpen() const { return fd >= 0; }
+    std::uint64_t recordCount() const { return records; }
+    std::uint64_t commitCount() const { return commits; }
+    const std::string &lastError() const { return error; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct FileHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t recordSize;
+    };
+
+    static const std::uint32_t VERSION = 1;
+
+    int fd;
+    std::size_t groupBytes;
+    Clock::duration window;
+    std::vector<char> pending;
+    Clock::time_point groupStart;
+    std::uint64_t records;
+    std::uint64_t commits;
+    std::string error;
+
+    static const char *magic() { return "GTWAL\r\n"; }
+
+    static std::uint16_t checksum(const WalRecord &record)
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&record);
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < offsetof(WalRecord, check); ++i)
+        {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return static_cast<std::uint16_t>(hash ^ (hash >> 16));
+    }
+
+    static int sync(int fd)
+    {
+#ifdef __linux__
+        return fdatasync(fd);
+#else
+        return fsync(fd);
+#endif
+    }
+
+    bool writeAll(const char *data, std::size_t length)
+    {
+        while (length)
+        {
+            ssize_t count = ::write(fd, data, length);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += count;
+            length -= count;
+        }
+        return true;
+    }
+
+    bool fail(const std::string &message)
+    {
+        error = message;
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        return false;
+    }
+};
+
+// open function for the Write-Ahead Log, replays the intact records and cuts off a damaged tail
+template <class Apply>
+inline bool WriteAheadLog::open(const std::string &fileName, Apply apply, std::uint64_t &replayed)
+{
+    close();
+    replayed = 0;
+    pending.clear();
+    fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return fail(std::strerror(errno));
+    }
+
+    FileHeader header;
+    ssize_t headerBytes = ::pread(fd, &header, sizeof(header), 0);
+    if (headerBytes < 0)
+    {
+        return fail(std::strerror(errno));
+    }
+    if (headerBytes < static_cast<ssize_t>(sizeof(header)))
+    {
+        // New log, or one whose header never made it to disk
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = VERSION;
+        header.recordSize = sizeof(WalRecord);
+        if (ftruncate(fd, 0) != 0 || !writeAll(reinterpret_cast<const char *>(&header), sizeof(header)) || sync(fd) != 0)
+        {
+            return fail(std::strerror(errno));
+        }
+        return true;
+    }
+    if (std::memcmp(header.magic, magic(), sizeof(header.magic)) != 0)
+    {
+        return fail("not a write-ahead log");
+    }
+    if (header.version != VERSION || header.recordSize != sizeof(WalRecord))
+    {
+        return fail("unsupported write-ahead log version");
+    }
+
+    // Replay in large reads; valid ends just past the last intact record
+    std::vector<WalRecord> chunk(4096);
+    off_t valid = sizeof(header);
+    bool damaged = false;
+    while (!damaged)
+    {
+        ssize_t count = ::pread(fd, chunk.data(), chunk.size() * sizeof(WalRecord), valid);
+        if (count < 0)
+        {
+            return fail(std::strerror(errno));
+        }
+        std::size_t whole = count / sizeof(WalRecord);
+        for (std::size_t i = 0; i < whole; ++i)
+        {
+            const WalRecord &record = chunk[i];
+            if (record.check != checksum(record) || record.type > CMD_CANCEL_RIDE || record.argCount > WalRecord::ARGS)
+            {
+                damaged = true;
+                break;
+            }
+            Command command;
+            command.type = static_cast<CommandType>(record.type);
+            command.argCount = record.argCount;
+            for (int arg = 0; arg < WalRecord::ARGS; ++arg)
+            {
+                command.args[arg] = record.args[arg];
+            }
+            if (!apply(static_cast<const Command &>(command)))
+            {
+                return fail("log inconsistent with state at record " + std::to_string(replayed + 1));
+            }
+            ++replayed;
+            valid += sizeof(WalRecord);
+        }
+        if (whole < chunk.size())
+        {
+            break;
+        }
+    }
+
+    if (ftruncate(fd, valid) != 0 || lseek(fd, valid, SEEK_SET) < 0)
+    {
+        return fail(std::strerror(errno));
+    }
+    return true;
+}
+
+#endif
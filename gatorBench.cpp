@@ -0,0 +1,1585 @@
+// Microbenchmarks for the gatorTaxi data structures.
+// Usage: gatorBench heap [maxRides]
+//        gatorBench queue [maxRides]
+//        gatorBench nodes [maxRides]
+//        gatorBench output [lines]
+//        gatorBench range [maxRides]
+//        gatorBench index [maxRides]
+//        gatorBench workload [key=value ...]
+//        gatorBench generate [key=value ...] > commands.txt
+//        gatorBench shards [maxThreads] [shards]
+//        gatorBench snapshot [maxRides]
+//        gatorBench wal [ops]
+//        gatorBench rangecache [ops]
+//        gatorBench order [maxRides]
+//        gatorBench nextrides [rides]
+//        gatorBench parallelprint [rides] [maxThreads]
+//        gatorBench lookup [maxRides]
+//        gatorBench fused [rides]
+//        gatorBench keys [maxRides]
+//   heap:  cancel and update-trip latency for pending sets of 1k rides up to maxRides (default 1M)
+//   queue: per-operation cost of each priority queue backend (binary, pairing, bucket, packed) for
+//          insert, update (new cost and duration), extract+reinsert churn and a full drain
+//   nodes: tree insert/remove throughput and resident memory; compare against per-node
+//          new/delete with the gatorBenchMalloc build (make gatorBenchMalloc)
+//   output: ride lines/sec written through ofstream + ostringstream + endl versus OutputWriter
+//   range:  rides/sec for range scans of 10 rides up to maxRides (default 1M), both walking the
+//           cursor alone and printing with Print(r1,r2) into /dev/null
+//   index:  Red-Black Tree versus B+ tree at 1M rides up to maxRides (default 10M, 100M needs
+//           about 12 GB): build time from random-order inserts, random lookups and rides/sec
+//           printed by Print(r1,r2) over ranges holding 100 and 10000 rides
+//   workload: runs a synthetic command mix (see WorkloadConfig::set for the keys, e.g.
+//           preload=10000000 ops=2000000 keys=sequential width=1000 hot=0.5 insert=40 next=10
+//           queue=pairing)
+//           and prints one JSON object per command type with throughput and p50/p99/p999 latency
+//   generate: writes the same workload as a gatorTaxi command file
+//   shards: ops/sec of the sharded store with 1 up to maxThreads (default: all cores) threads
+//           issuing a mixed command stream concurrently against 100k preloaded rides
+//   snapshot: seconds to rebuild 100k up to maxRides (default 10M) rides by replaying their
+//           Insert commands versus writing a snapshot and restoring the tree and heap from it
+//   wal:   commands/sec of the default workload mix (default 200k commands) with no write-ahead
+//          log and with group commits of growing byte sizes, from a sync per record upwards
+//   rangecache: commands/sec of a read-heavy mix (default 1M commands: Print over 64 fixed
+//          windows of 100 rides against 100k pending, with 2%, 10% and 30% UpdateTrip) without
+//          and with the range cache, and its hit rate
+//   order: for 100k up to maxRides (default 10M) pending rides in each index, the cost of
+//          Count(r1,r2), of fetching a 20-ride page at a random offset with Print(r1,r2,offset,20)
+//          and of printing the whole range, which is what paging cost without order statistics
+//   nextrides: rides/sec dispatched from rides (default 1M) pending rides in waves of k, by k
+//          GetNextRide commands versus one GetNextRides(k), for each index, and the cost of
+//          PeekNextRides(k) on the full queue; first checks that both write the same output,
+//          also when k is more than the rides pending
+//   parallelprint: rides/sec printed by Print(r1,r2) over ranges of 1/4 and all of rides (default
+//          4M) pending rides, serially and split over 2 up to maxThreads (default: all cores)
+//          threads, checking that every output matches the serial one
+//   lookup: for 100k up to maxRides (default 10M) pending rides in each index, with and without
+//          --hash-index, the cost of a search hit and miss, of an Insert+CancelRide pair and of
+//          Print(x), and the resident memory
+//   fused: ns per Insert, UpdateTrip and CancelRide over rides (default 1M) ride numbers taken in
+//          ascending and in random order, for each index, done as a search followed by the change
+//          (two_pass) versus the fused tryInsert, updateTrip and cancelRide (fused)
+//   keys:  for 100k up to maxRides (default 10M) rides, insert, search and GetNextRide in the tree
+//          with 32-bit (RBTree) versus 64-bit (BasicRBTree<long long>) ride numbers, and the queue
+//          operations of the binary heap versus 4- and 8-ary heaps; first checks that a 64-bit tree
+//          holding ride numbers past 2^32 prints and dispatches like the 32-bit one
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "BPlusTree.h"
+#include "CommandExecutor.h"
+#include "OutputWriter.h"
+#include "ParallelRangePrinter.h"
+#include "RBTree.h"
+#include "RangeCache.h"
+#include "ShardedRideStore.h"
+#include "Snapshot.h"
+#include "WorkloadGenerator.h"
+#include "WriteAheadLog.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Every member of the templated engine is compiled here, also the ones gatorTaxi never calls,
+// for the widths and arities the keys benchmark compares
+template class BasicRBTree<int>;
+template class BasicRBTree<long long>;
+template class BasicMinHeap<RBTNode, RideOrder, 2>;
+template class BasicMinHeap<RBTNode, RideOrder, 4>;
+template class BasicMinHeap<RBTNode, RideOrder, 8>;
+template class BasicMinHeap<BasicRBTNode<long long>, RideOrder, 2>;
+template class BasicRideHashIndex<BasicRBTNode<long long>>;
+
+static double elapsedNs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Resident set size in KB, falls back to the peak RSS where /proc is not available
+static long residentKb()
+{
+    long pages = 0, resident = 0;
+    FILE *statm = std::fopen("/proc/self/statm", "r");
+    if (statm)
+    {
+        int read = std::fscanf(statm, "%ld %ld", &pages, &resident);
+        std::fclose(statm);
+        if (read == 2)
+        {
+            return resident * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// Builds a tree holding rides 0..n-1 inserted in random order
+static void fillTree(RBTree &tree, int n, std::mt19937 &rng)
+{
+    std::vector<int> numbers(n);
+    for (int i = 0; i < n; ++i)
+    {
+        numbers[i] = i;
+    }
+    std::shuffle(numbers.begin(), numbers.end(), rng);
+    for (int rideNumber : numbers)
+    {
+        tree.insert(Ride(rideNumber, rng() % 1000, 1 + rng() % 1000));
+    }
+}
+
+// Cancel and update-trip latency at growing pending-set sizes
+static void benchHeap(int maxRides)
+{
+    const int opsPerSize = 200000;
+    std::printf("%10s %12s %12s %12s\n", "rides", "cancel_ns", "reinsert_ns", "update_ns");
+
+    for (int n = 1000; n <= maxRides; n *= 10)
+    {
+        std::mt19937 rng(n);
+        RBTree tree(n);
+        fillTree(tree, n, rng);
+
+        // Cancel a batch of rides, then put them back so the pending set stays at n
+        int batch = std::max(1, n / 10);
+        double cancelNs = 0, reinsertNs = 0;
+        int cancels = 0;
+        std::vector<int> picked(batch);
+        while (cancels < opsPerSize)
+        {
+            for (int i = 0; i < batch; ++i)
+            {
+                picked[i] = rng() % n;
+            }
+            std::sort(picked.begin(), picked.end());
+            picked.erase(std::unique(picked.begin(), picked.end()), picked.end());
+            std::shuffle(picked.begin(), picked.end(), rng);
+
+            Clock::time_point start = Clock::now();
+            for (int rideNumber : picked)
+            {
+                tree.cancelRide(rideNumber);
+            }
+            cancelNs += elapsedNs(start);
+
+            start = Clock::now();
+            for (int rideNumber : picked)
+            {
+                tree.insert(Ride(rideNumber, rng() % 1000, 1 + rng() % 1000));
+            }
+            reinsertNs += elapsedNs(start);
+            cancels += picked.size();
+            picked.resize(batch);
+        }
+
+        // Update trips with durations up to twice the old one, so rides stay pending
+        std::vector<int> targets(opsPerSize);
+        std::vector<int> durations(opsPerSize);
+        for (int i = 0; i < opsPerSize; ++i)
+        {
+            targets[i] = rng() % n;
+            durations[i] = 1 + rng() % 1000;
+        }
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < opsPerSize; ++i)
+        {
+            RBTNode *node = tree.search(targets[i]);
+            tree.updateTrip(targets[i], std::min(durations[i], 2 * node->ride.tripDuration));
+        }
+        double updateNs = elapsedNs(start);
+
+        std::printf("%10d %12.1f %12.1f %12.1f\n", n, cancelNs / cancels, reinsertNs / cancels, updateNs / opsPerSize);
+        std::fflush(stdout);
+    }
+}
+
+// Priority queue backends driven directly with the same operation streams
+static void benchQueue(int maxRides)
+{
+    const int opsPerSize = 1000000;
+    const QueueKind kinds[] = {QUEUE_BINARY, QUEUE_PAIRING, QUEUE_BUCKET, QUEUE_PACKED};
+    std::printf("%10s %8s %11s %11s %11s %11s\n", "rides", "queue", "insert_ns", "update_ns", "churn_ns", "extract_ns");
+
+    for (int n = 1000; n <= maxRides; n *= 10)
+    {
+        for (QueueKind kind : kinds)
+        {
+            std::mt19937 rng(n);
+            std::vector<RBTNode> pool;
+            pool.reserve(n);
+            for (int i = 0; i < n; ++i)
+            {
+                pool.push_back(RBTNode(Ride(i, 1 + rng() % 1000, 1 + rng() % 1000), nullptr, nullptr, nullptr, BLACK));
+            }
+            std::unique_ptr<RideQueue> queue(RBTree::createQueue(kind, 100));
+            long long checksum = 0;
+
+            Clock::time_point start = Clock::now();
+            for (RBTNode &node : pool)
+            {
+                queue->insert(&node);
+            }
+            double insertNs = elapsedNs(start);
+
+            start = Clock::now();
+            for (int i = 0; i < opsPerSize; ++i)
+            {
+                RBTNode *node = &pool[rng() % n];
+                node->ride.rideCost = 1 + rng() % 1000;
+                node->ride.tripDuration = 1 + rng() % 1000;
+                queue->update(node);
+            }
+            double updateNs = elapsedNs(start);
+
+            start = Clock::now();
+            for (int i = 0; i < opsPerSize; ++i)
+            {
+                RBTNode *node = queue->extractMin();
+                checksum += node->ride.rideNumber;
+                node->ride.rideCost = 1 + rng() % 1000;
+                queue->insert(node);
+            }
+            double churnNs = elapsedNs(start);
+
+            start = Clock::now();
+            while (!queue->isEmpty())
+            {
+                checksum += queue->extractMin()->ride.rideCost;
+            }
+            double extractNs = elapsedNs(start);
+
+            std::printf("%10d %8s %11.1f %11.1f %11.1f %11.1f\n", n, queueKindName(kind), insertNs / n, updateNs / opsPerSize,
+                        churnNs / opsPerSize, extractNs / n);
+            std::fflush(stdout);
+            if (checksum < 0)
+            {
+                std::printf("unreachable\n");
+            }
+        }
+    }
+}
+
+// Insert and remove throughput of the tree, plus memory held once it is full
+static void benchNodes(int maxRides)
+{
+    std::printf("%s nodes\n", RBTNodeArena::bulkRelease ? "arena" : "malloc");
+    std::printf("%10s %12s %12s %12s %12s\n", "rides", "insert_Mops", "churn_Mops", "remove_Mops", "rss_kb");
+
+    for (int n = 1000; n <= maxRides; n *= 10)
+    {
+        std::mt19937 rng(n);
+        std::vector<int> numbers(n);
+        for (int i = 0; i < n; ++i)
+        {
+            numbers[i] = i;
+        }
+        std::shuffle(numbers.begin(), numbers.end(), rng);
+
+        long rssBefore = residentKb();
+        RBTree *tree = new RBTree(n);
+        Clock::time_point start = Clock::now();
+        for (int rideNumber : numbers)
+        {
+            tree->insert(Ride(rideNumber, rng() % 1000, 1 + rng() % 1000));
+        }
+        double insertNs = elapsedNs(start);
+        long rss = residentKb() - rssBefore;
+
+        // Cancel a ride and insert a fresh one in its place, the steady-state pattern of a busy day
+        int churn = std::max(n, 200000);
+        int nextRideNumber = n;
+        start = Clock::now();
+        for (int i = 0; i < churn; ++i)
+        {
+            int slot = rng() % n;
+            tree->cancelRide(numbers[slot]);
+            numbers[slot] = nextRideNumber++;
+            tree->insert(Ride(numbers[slot], rng() % 1000, 1 + rng() % 1000));
+        }
+        double churnNs = elapsedNs(start);
+
+        std::shuffle(numbers.begin(), numbers.end(), rng);
+        start = Clock::now();
+        for (int rideNumber : numbers)
+        {
+            tree->cancelRide(rideNumber);
+        }
+        double removeNs = elapsedNs(start);
+        delete tree;
+
+        std::printf("%10d %12.2f %12.2f %12.2f %12ld\n", n, n * 1e3 / insertNs, churn * 1e3 / churnNs, n * 1e3 / removeNs, rss);
+        std::fflush(stdout);
+    }
+}
+
+// Lines/sec for printing rides the old way (a stream per ride, flush per line) and through OutputWriter
+static void benchOutput(int lines)
+{
+    const char *path = "gatorBench_output.tmp";
+    std::mt19937 rng(lines);
+    std::vector<Ride> rides;
+    for (int i = 0; i < 4096; ++i)
+    {
+        rides.push_back(Ride(rng() % 10000000, rng() % 1000, 1 + rng() % 1000));
+    }
+
+    Clock::time_point start = Clock::now();
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < lines; ++i)
+        {
+            const Ride &ride = rides[i % rides.size()];
+            std::ostringstream oss;
+            oss << "(" << ride.rideNumber << "," << ride.rideCost << "," << ride.tripDuration << ")";
+            out << oss.str() << std::endl;
+        }
+    }
+    double streamNs = elapsedNs(start);
+
+    start = Clock::now();
+    {
+        OutputWriter out;
+        out.open(path);
+        for (int i = 0; i < lines; ++i)
+        {
+            out.writeRide(rides[i % rides.size()]);
+            out.put('\n');
+        }
+    }
+    double writerNs = elapsedNs(start);
+    std::remove(path);
+
+    std::printf("%12s %14s\n", "sink", "lines_per_sec");
+    std::printf("%12s %14.0f\n", "ofstream", lines * 1e9 / streamNs);
+    std::printf("%12s %14.0f\n", "OutputWriter", lines * 1e9 / writerNs);
+}
+
+// Range-scan throughput over a tree holding rides 0..maxRides-1
+static void benchRange(int maxRides)
+{
+    std::mt19937 rng(maxRides);
+    RBTree tree(maxRides);
+    fillTree(tree, maxRides, rng);
+
+    OutputWriter sink;
+    sink.open("/dev/null");
+
+    std::printf("%10s %16s %16s\n", "width", "scan_rides_sec", "print_rides_sec");
+    for (int width = 10; width <= maxRides; width *= 10)
+    {
+        // Enough queries to visit about 10M rides per width
+        int queries = std::max(1, 10000000 / width);
+        std::vector<int> starts(queries);
+        for (int i = 0; i < queries; ++i)
+        {
+            starts[i] = rng() % (maxRides - width + 1);
+        }
+
+        long long visited = 0, checksum = 0;
+        Clock::time_point start = Clock::now();
+        for (int lo : starts)
+        {
+            RBTree::RangeCursor cursor = tree.range(lo, lo + width - 1);
+            for (RBTNode *node = cursor.next(); node; node = cursor.next())
+            {
+                checksum += node->ride.rideCost;
+                ++visited;
+            }
+        }
+        double scanNs = elapsedNs(start);
+
+        start = Clock::now();
+        for (int lo : starts)
+        {
+            tree.printRange(lo, lo + width - 1, sink);
+            sink.put('\n');
+        }
+        sink.flush();
+        double printNs = elapsedNs(start);
+
+        std::printf("%10d %16.0f %16.0f\n", width, visited * 1e9 / scanNs, visited * 1e9 / printNs);
+        std::fflush(stdout);
+        if (checksum < 0)
+        {
+            std::printf("unreachable\n");
+        }
+    }
+}
+
+// One ingest thread of the shards benchmark: inserts new rides and looks up, updates, cancels and
+// range-prints its own recent ones, with the odd GetNextRide; ride numbers are thread-unique and
+// scrambled over 31 bits so every shard sees traffic
+static void shardWorker(ShardedRideStore &store, int thread, int threads, int operations, long long &checksum)
+{
+    std::mt19937 rng(thread + 1);
+    std::vector<int> live;
+    std::vector<Ride> rides;
+    std::uint32_t index = 0;
+    long long sum = 0;
+
+    for (int i = 0; i < operations; ++i)
+    {
+        int pick = rng() % 100;
+        if (pick < 40 || live.empty())
+        {
+            std::uint32_t key = (1000000u + index++) * threads + thread;
+            int rideNumber = static_cast<int>((key * 2654435761u) & 0x7fffffff);
+            if (store.insert(Ride(rideNumber, rng() % 1000 + 1, rng() % 1000 + 1)))
+                live.push_back(rideNumber);
+            continue;
+        }
+
+        std::size_t slot = rng() % live.size();
+        int rideNumber = live[slot];
+        Ride ride(0, 0, 0);
+        if (pick < 60)
+        {
+            store.find(rideNumber, ride);
+            sum += ride.rideCost;
+        }
+        else if (pick < 75)
+        {
+            store.updateTrip(rideNumber, rng() % 1000 + 1);
+        }
+        else if (pick < 95)
+        {
+            store.cancelRide(rideNumber);
+            live[slot] = live.back();
+            live.pop_back();
+        }
+        else if (pick < 99)
+        {
+            rides.clear();
+            store.collectRange(rideNumber, rideNumber + (1 << 16), rides);
+            sum += rides.size();
+        }
+        else if (store.getNextRide(ride))
+        {
+            sum += ride.rideNumber;
+        }
+    }
+    checksum = sum;
+}
+
+// Throughput of the sharded store as ingest threads are added
+static void benchShards(int maxThreads, int shardCount)
+{
+    const int preload = 100000;
+    const int operations = 1000000; // per thread
+
+    std::printf("%8s %8s %14s %10s\n", "threads", "shards", "ops_sec", "speedup");
+    double baseline = 0;
+    // 1, 2, 4, ... threads and finally maxThreads itself
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int threads : threadCounts)
+    {
+        ShardedRideStore store(shardCount);
+        std::mt19937 rng(preload);
+        for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(preload); ++i)
+        {
+            store.insert(Ride(static_cast<int>((i * 2654435761u) & 0x7fffffff), rng() % 1000 + 1, rng() % 1000 + 1));
+        }
+
+        std::vector<long long> checksums(threads);
+        std::vector<std::thread> workers;
+        Clock::time_point start = Clock::now();
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.push_back(std::thread(shardWorker, std::ref(store), t, threads, operations, std::ref(checksums[t])));
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        double ns = elapsedNs(start);
+
+        double opsPerSec = static_cast<double>(threads) * operations * 1e9 / ns;
+        if (threads == 1)
+            baseline = opsPerSec;
+        std::printf("%8d %8d %14.0f %10.2f\n", threads, store.shardCount(), opsPerSec, opsPerSec / baseline);
+        std::fflush(stdout);
+        if (checksums[0] < 0)
+        {
+            std::printf("unreachable\n");
+        }
+    }
+}
+
+// Point lookups and range prints through each ordered index, filled in random order
+static void benchIndex(int maxRides)
+{
+    const int lookups = 1000000;
+    const IndexKind kinds[] = {INDEX_RBTREE, INDEX_BTREE};
+    OutputWriter sink;
+    sink.open("/dev/null");
+
+    std::printf("%11s %7s %8s %8s %10s %10s %14s %14s %10s\n", "rides", "index", "height", "build_s", "hit_ns", "miss_ns",
+                "print100_sec", "print10k_sec", "rss_kb");
+    for (long long n = 1000000; n <= maxRides; n *= 10)
+    {
+        // Even ride numbers are present, odd ones are misses
+        std::vector<int> order(n);
+        for (long long i = 0; i < n; ++i)
+        {
+            order[i] = static_cast<int>(2 * i);
+        }
+        std::mt19937 rng(static_cast<std::uint32_t>(n));
+        std::shuffle(order.begin(), order.end(), rng);
+        std::vector<int> probes(lookups);
+        for (int &probe : probes)
+        {
+            probe = static_cast<int>(2 * (rng() % n));
+        }
+
+        for (IndexKind kind : kinds)
+        {
+            std::unique_ptr<RideIndex> index;
+            if (kind == INDEX_BTREE)
+                index.reset(new BPlusTree(n));
+            else
+                index.reset(new RBTree(n));
+
+            Clock::time_point start = Clock::now();
+            for (int rideNumber : order)
+            {
+                index->insert(Ride(rideNumber, 1 + rideNumber % 1000, 1 + rideNumber % 997));
+            }
+            double buildNs = elapsedNs(start);
+
+            long long found = 0;
+            start = Clock::now();
+            for (int probe : probes)
+            {
+                found += index->search(probe) != nullptr;
+            }
+            double hitNs = elapsedNs(start);
+            start = Clock::now();
+            for (int probe : probes)
+            {
+                found += index->search(probe + 1) != nullptr;
+            }
+            double missNs = elapsedNs(start);
+
+            // About 10M rides printed per width
+            double ridesPerSec[2];
+            const int widths[] = {200, 20000};
+            for (int w = 0; w < 2; ++w)
+            {
+                int queries = static_cast<int>(std::min<long long>(n, 20000000LL / widths[w]));
+                start = Clock::now();
+                for (int q = 0; q < queries; ++q)
+                {
+                    int lo = probes[q % lookups];
+                    index->printRange(lo, lo + widths[w] - 1, sink);
+                    sink.put('\n');
+                }
+                sink.flush();
+                ridesPerSec[w] = queries * (widths[w] / 2) * 1e9 / elapsedNs(start);
+            }
+
+            std::printf("%11lld %7s %8d %8.2f %10.1f %10.1f %14.0f %14.0f %10ld\n", n, indexKindName(kind), index->height(), buildNs / 1e9,
+                        hitNs / lookups, missNs / lookups, ridesPerSec[0], ridesPerSec[1], residentKb());
+            std::fflush(stdout);
+            if (found != lookups)
+            {
+                std::printf("lookup mismatch: %lld\n", found);
+            }
+        }
+    }
+}
+
+// Range counts and 20-ride pages by offset versus printing the whole range
+static void benchOrder(int maxRides)
+{
+    const int queries = 200000;
+    const IndexKind kinds[] = {INDEX_RBTREE, INDEX_BTREE};
+    OutputWriter sink;
+    sink.open("/dev/null");
+
+    std::printf("%11s %7s %10s %10s %14s\n", "rides", "index", "count_ns", "page_ns", "full_print_ms");
+    for (long long n = 100000; n <= maxRides; n *= 10)
+    {
+        std::vector<Ride> rides;
+        rides.reserve(n);
+        for (long long i = 0; i < n; ++i)
+        {
+            rides.push_back(Ride(static_cast<int>(2 * i), 1 + i % 1000, 1 + i % 997));
+        }
+        std::mt19937 rng(static_cast<std::uint32_t>(n));
+        std::vector<int> bounds(queries);
+        for (int &bound : bounds)
+        {
+            bound = static_cast<int>(rng() % (2 * n));
+        }
+
+        for (IndexKind kind : kinds)
+        {
+            std::unique_ptr<RideIndex> index;
+            if (kind == INDEX_BTREE)
+                index.reset(new BPlusTree(n));
+            else
+                index.reset(new RBTree(n));
+            index->appendSorted(rides);
+
+            std::size_t counted = 0;
+            Clock::time_point start = Clock::now();
+            for (int q = 0; q < queries; ++q)
+            {
+                counted += index->count(bounds[q], bounds[q] + static_cast<int>(n));
+            }
+            double countNs = elapsedNs(start) / queries;
+
+            start = Clock::now();
+            for (int q = 0; q < queries; ++q)
+            {
+                index->printPage(0, INT_MAX, bounds[q] / 2, 20, sink);
+                sink.put('\n');
+            }
+            sink.flush();
+            double pageNs = elapsedNs(start) / queries;
+
+            start = Clock::now();
+            index->printRange(0, INT_MAX, sink);
+            sink.put('\n');
+            sink.flush();
+            double fullMs = elapsedNs(start) / 1e6;
+
+            std::printf("%11lld %7s %10.1f %10.1f %14.2f\n", n, indexKindName(kind), countNs, pageNs, fullMs);
+            std::fflush(stdout);
+            if (counted == 0)
+            {
+                std::printf("no rides counted\n");
+            }
+        }
+    }
+}
+
+// Output of draining rides in waves of k, as k GetNextRide commands or as one GetNextRides(k);
+// the last wave asks for more rides than are left
+static std::string drainNextRides(const std::vector<Ride> &rides, int k, bool batched)
+{
+    RBTree index;
+    for (const Ride &ride : rides)
+    {
+        index.insert(ride);
+    }
+
+    std::string text;
+    OutputWriter writer;
+    writer.openString(text);
+    CommandExecutor executor(index, writer, false);
+    Command command;
+    command.type = batched ? CMD_GET_NEXT_RIDES : CMD_GET_NEXT_RIDE;
+    command.args[0] = k;
+    command.argCount = batched ? 1 : 0;
+    int waves = static_cast<int>(rides.size()) / k + 2;
+    for (int i = 0; i < (batched ? waves : waves * k); ++i)
+    {
+        executor.execute(command);
+    }
+    writer.close();
+    return text;
+}
+
+// Dispatch waves of k rides as k GetNextRide commands versus one GetNextRides(k)
+static void benchNextRides(int rideCount)
+{
+    const IndexKind kinds[] = {INDEX_RBTREE, INDEX_BTREE};
+    const int waves[] = {1, 16, 256, 4096};
+    std::vector<Ride> rides;
+    rides.reserve(rideCount);
+    std::mt19937 rng(42);
+    for (int i = 0; i < rideCount; ++i)
+    {
+        rides.push_back(Ride(i, static_cast<int>(rng() % 1000), 1 + static_cast<int>(rng() % 1000)));
+    }
+    OutputWriter sink;
+    sink.open("/dev/null");
+
+    // 100 rides with many equal ones, drained past the end in waves of 7
+    std::vector<Ride> small(rides.begin(), rides.begin() + std::min(rideCount, 100));
+    for (Ride &ride : small)
+    {
+        ride.rideCost %= 5;
+        ride.tripDuration %= 3;
+    }
+    std::printf("GetNextRides(k) output matches k GetNextRide: %s\n", drainNextRides(small, 7, true) == drainNextRides(small, 7, false) ? "yes" : "NO");
+
+    std::printf("%7s %6s %14s %14s %10s\n", "index", "k", "single_sec", "batched_sec", "peek_us");
+    for (IndexKind kind : kinds)
+    {
+        for (int k : waves)
+        {
+            double ridesPerSec[2];
+            double peekUs = 0;
+            for (int batched = 0; batched < 2; ++batched)
+            {
+                std::unique_ptr<RideIndex> index;
+                if (kind == INDEX_BTREE)
+                    index.reset(new BPlusTree(rideCount));
+                else
+                    index.reset(new RBTree(rideCount));
+                index->appendSorted(rides);
+
+                if (batched)
+                {
+                    std::vector<RBTNode *> peeked;
+                    Clock::time_point start = Clock::now();
+                    index->minHeap->peekSmallest(k, peeked);
+                    peekUs = elapsedNs(start) / 1e3;
+                }
+
+                CommandExecutor executor(*index, sink, false);
+                Command command;
+                command.type = batched ? CMD_GET_NEXT_RIDES : CMD_GET_NEXT_RIDE;
+                command.args[0] = k;
+                command.argCount = batched ? 1 : 0;
+                int commands = batched ? rideCount / k : rideCount / k * k;
+                Clock::time_point start = Clock::now();
+                for (int i = 0; i < commands; ++i)
+                {
+                    executor.execute(command);
+                }
+                sink.flush();
+                ridesPerSec[batched] = rideCount / k * k * 1e9 / elapsedNs(start);
+            }
+            std::printf("%7s %6d %14.0f %14.0f %10.1f\n", indexKindName(kind), k, ridesPerSec[0], ridesPerSec[1], peekUs);
+            std::fflush(stdout);
+        }
+    }
+}
+
+// Wide Print(r1,r2) formatted on one thread versus split over several
+static void benchParallelPrint(int rideCount, unsigned maxThreads)
+{
+    const IndexKind kinds[] = {INDEX_RBTREE, INDEX_BTREE};
+    std::vector<Ride> rides;
+    rides.reserve(rideCount);
+    for (int i = 0; i < rideCount; ++i)
+    {
+        rides.push_back(Ride(i, 1 + i % 1000, 1 + i % 997));
+    }
+
+    std::printf("%7s %10s %8s %14s %8s\n", "index", "range", "threads", "rides_sec", "same");
+    for (IndexKind kind : kinds)
+    {
+        std::unique_ptr<RideIndex> index;
+        if (kind == INDEX_BTREE)
+            index.reset(new BPlusTree(rideCount));
+        else
+            index.reset(new RBTree(rideCount));
+        index->appendSorted(rides);
+
+        const int widths[] = {rideCount / 4, rideCount};
+        for (int width : widths)
+        {
+            std::string serial;
+            for (unsigned threads = 1; threads <= maxThreads; threads = threads == 1 ? 2 : threads * 2)
+            {
+                ParallelRangePrinter printer(threads, 1);
+                std::string text;
+                OutputWriter writer;
+                writer.openString(text);
+                Clock::time_point start = Clock::now();
+                printer.printRange(*index, 0, width - 1, writer);
+                writer.close();
+                double ns = elapsedNs(start);
+                if (threads == 1)
+                    serial.swap(text);
+                std::printf("%7s %10d %8u %14.0f %8s\n", indexKindName(kind), width, threads, width * 1e9 / ns, threads == 1 || text == serial ? "yes" : "NO");
+                std::fflush(stdout);
+            }
+        }
+    }
+}
+
+// Replay of a command log holding n Inserts in random order versus a snapshot round trip
+static void benchSnapshot(int maxRides)
+{
+    const std::string fileName = "gatorBench.snapshot";
+    OutputWriter sink;
+    sink.open("/dev/null");
+
+    std::printf("%11s %10s %10s %10s %12s\n", "rides", "replay_s", "write_s", "restore_s", "image_bytes");
+    for (long long n = 100000; n <= maxRides; n *= 10)
+    {
+        std::vector<int> order(n);
+        for (long long i = 0; i < n; ++i)
+        {
+            order[i] = static_cast<int>(i);
+        }
+        std::mt19937 rng(static_cast<std::uint32_t>(n));
+        std::shuffle(order.begin(), order.end(), rng);
+        std::string log;
+        char line[64];
+        for (int rideNumber : order)
+        {
+            log.append(line, std::snprintf(line, sizeof(line), "Insert(%d,%d,%d)\n", rideNumber, 1 + rideNumber % 1000, 1 + rideNumber % 997));
+        }
+
+        RBTree replayed;
+        Clock::time_point start = Clock::now();
+        {
+            CommandExecutor executor(replayed, sink);
+            Command command;
+            const char *error = nullptr;
+            const char *begin = log.data();
+            const char *end = begin + log.size();
+            while (begin < end)
+            {
+                const char *newline = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+                if (CommandParser::parse(begin, newline, command, error) == PARSE_OK)
+                {
+                    executor.execute(command);
+                }
+                begin = newline + 1;
+            }
+            executor.finish();
+        }
+        double replayNs = elapsedNs(start);
+
+        Snapshot::Position position = {log.size(), static_cast<std::uint64_t>(n), 0};
+        std::string error;
+        start = Clock::now();
+        if (!Snapshot::write(fileName, replayed, position, error))
+        {
+            std::printf("snapshot write failed: %s\n", error.c_str());
+            return;
+        }
+        double writeNs = elapsedNs(start);
+
+        RBTree restored;
+        start = Clock::now();
+        Snapshot image;
+        if (!image.open(fileName))
+        {
+            std::printf("snapshot load failed: %s\n", image.lastError().c_str());
+            return;
+        }
+        restored.appendSorted(image.rides(), image.rideCount());
+        double restoreNs = elapsedNs(start);
+
+        std::printf("%11lld %10.3f %10.3f %10.3f %12zu\n", n, replayNs / 1e9, writeNs / 1e9, restoreNs / 1e9,
+                    sizeof(SnapshotHeader) + image.rideCount() * sizeof(Ride));
+        std::fflush(stdout);
+        if (restored.size() != replayed.size() || restored.minHeap->getMin()->ride.rideNumber != replayed.minHeap->getMin()->ride.rideNumber)
+        {
+            std::printf("restored state differs\n");
+        }
+        image.close();
+        std::remove(fileName.c_str());
+    }
+}
+
+// Commands/sec with the write-ahead log off and at growing group commit sizes
+static void benchWal(long operations)
+{
+    const std::string fileName = "gatorBench.wal";
+    WorkloadConfig config;
+    config.preload = 0;
+    config.operations = operations;
+    WorkloadGenerator generator(config);
+    std::vector<Command> commands;
+    Command command;
+    while (generator.next(command))
+    {
+        commands.push_back(command);
+    }
+
+    OutputWriter sink;
+    sink.open("/dev/null");
+    // 0 is the run without a log; every group waits for its bytes, not a time window
+    const std::size_t groups[] = {0, sizeof(WalRecord), 1024, 16 * 1024, 256 * 1024};
+    std::printf("%12s %14s %10s %10s %14s\n", "group_bytes", "commands_sec", "records", "commits", "records_commit");
+    for (std::size_t groupBytes : groups)
+    {
+        std::remove(fileName.c_str());
+        RBTree tree;
+        WriteAheadLog wal(groupBytes, 60 * 1000000);
+        std::uint64_t replayed = 0;
+        if (groupBytes && !wal.open(fileName, [](const Command &) { return true; }, replayed))
+        {
+            std::printf("wal open failed: %s\n", wal.lastError().c_str());
+            return;
+        }
+
+        Clock::time_point start = Clock::now();
+        {
+            CommandExecutor executor(tree, sink, false);
+            if (groupBytes)
+            {
+                executor.wal = &wal;
+            }
+            for (const Command &next : commands)
+            {
+                executor.execute(next);
+            }
+            wal.close();
+        }
+        double ns = elapsedNs(start);
+        sink.flush();
+
+        std::printf("%12zu %14.0f %10llu %10llu %14.1f\n", groupBytes, commands.size() * 1e9 / ns, static_cast<unsigned long long>(wal.recordCount()),
+                    static_cast<unsigned long long>(wal.commitCount()), wal.commitCount() ? static_cast<double>(wal.recordCount()) / wal.commitCount() : 0.0);
+        std::fflush(stdout);
+    }
+    std::remove(fileName.c_str());
+}
+
+// Dashboard-style repeated Print windows between mutations, with and without the range cache
+static void benchRangeCache(long operations)
+{
+    const int rides = 100000;
+    const int windows = 64;
+    const int width = 200; // even ride numbers only, so 100 rides a window
+    const int updateShares[] = {2, 10, 30};
+    OutputWriter sink;
+    sink.open("/dev/null");
+
+    std::printf("%8s %12s %14s %10s %14s\n", "update_%", "cache", "commands_sec", "hit_rate", "invalidations");
+    for (int updateShare : updateShares)
+    {
+        std::mt19937 rng(static_cast<std::uint32_t>(updateShare));
+        std::vector<int> starts(windows);
+        for (int &start : starts)
+        {
+            start = 2 * static_cast<int>(rng() % (rides - width / 2));
+        }
+        std::vector<Command> commands(operations);
+        for (Command &command : commands)
+        {
+            if (static_cast<int>(rng() % 100) < updateShare)
+            {
+                command.type = CMD_UPDATE_TRIP;
+                command.args[0] = 2 * static_cast<int>(rng() % rides);
+                command.args[1] = 1 + rng() % 1000;
+            }
+            else
+            {
+                command.type = CMD_PRINT_RANGE;
+                command.args[0] = starts[rng() % windows];
+                command.args[1] = command.args[0] + width - 1;
+            }
+        }
+
+        const std::size_t capacities[] = {0, 128};
+        for (std::size_t capacity : capacities)
+        {
+            RBTree tree(rides);
+            std::vector<Ride> preload;
+            for (int i = 0; i < rides; ++i)
+            {
+                preload.push_back(Ride(2 * i, 1 + i % 1000, 1 + i % 997));
+            }
+            tree.appendSorted(preload);
+
+            RangeCache cache(capacity);
+            CommandExecutor executor(tree, sink);
+            if (capacity)
+            {
+                executor.rangeCache = &cache;
+            }
+            Clock::time_point start = Clock::now();
+            for (const Command &command : commands)
+            {
+                executor.execute(command);
+            }
+            sink.flush();
+            double ns = elapsedNs(start);
+
+            std::uint64_t lookups = cache.hitCount() + cache.missCount();
+            std::printf("%8d %12zu %14.0f %10.3f %14llu\n", updateShare, capacity, operations * 1e9 / ns,
+                        lookups ? static_cast<double>(cache.hitCount()) / lookups : 0.0, static_cast<unsigned long long>(cache.invalidationCount()));
+            std::fflush(stdout);
+        }
+    }
+}
+
+static bool parseWorkloadConfig(int argc, char *argv[], WorkloadConfig &config)
+{
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        std::size_t equals = arg.find('=');
+        if (equals == std::string::npos || !config.set(arg.substr(0, equals), arg.substr(equals + 1)))
+        {
+            std::fprintf(stderr, "Bad workload setting: %s\n", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sample value at quantile q of sorted samples
+static std::uint32_t percentile(const std::vector<std::uint32_t> &sorted, double q)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+static void printLatencyJson(const char *op, std::vector<std::uint32_t> &samples, double totalNs)
+{
+    std::sort(samples.begin(), samples.end());
+    std::printf("{\"suite\":\"workload\",\"op\":\"%s\",\"count\":%zu,\"total_ms\":%.3f,\"ops_per_sec\":%.0f,"
+                "\"p50_ns\":%u,\"p99_ns\":%u,\"p999_ns\":%u,\"max_ns\":%u}\n",
+                op, samples.size(), totalNs / 1e6, samples.empty() ? 0.0 : samples.size() * 1e9 / totalNs,
+                percentile(samples, 0.5), percentile(samples, 0.99), percentile(samples, 0.999), samples.empty() ? 0 : samples.back());
+}
+
+// Runs a generated workload against the tree and heap, timing every measured command
+static void benchWorkload(const WorkloadConfig &config)
+{
+    WorkloadGenerator generator(config);
+    Command command;
+
+    // Preload: the generator's first config.preload commands are Inserts of unique rides,
+    // loaded in bulk so that even tens of millions of pending rides set up quickly
+    std::vector<Ride> preload;
+    preload.reserve(config.preload);
+    for (long i = 0; i < config.preload && generator.next(command); ++i)
+    {
+        preload.push_back(Ride(command.args[0], command.args[1], command.args[2]));
+    }
+    std::sort(preload.begin(), preload.end(), [](const Ride &a, const Ride &b)
+              { return a.rideNumber < b.rideNumber; });
+
+    RBTree tree(preload.size(), config.queue);
+    Clock::time_point start = Clock::now();
+    tree.appendSorted(preload);
+    double preloadMs = elapsedNs(start) / 1e6;
+    std::vector<Ride>().swap(preload);
+
+    OutputWriter sink;
+    sink.open("/dev/null");
+    CommandExecutor executor(tree, sink, false);
+
+    static const char *names[] = {"Insert", "Print", "PrintRange", "UpdateTrip", "GetNextRide", "CancelRide"};
+    const int types = sizeof(names) / sizeof(names[0]);
+    std::vector<std::uint32_t> samples[types];
+    double totals[types] = {0};
+
+    while (generator.next(command))
+    {
+        Clock::time_point opStart = Clock::now();
+        executor.execute(command);
+        double ns = elapsedNs(opStart);
+        samples[command.type].push_back(static_cast<std::uint32_t>(ns));
+        totals[command.type] += ns;
+    }
+    sink.flush();
+
+    std::printf("{\"suite\":\"workload\",\"seed\":%u,\"preload\":%ld,\"ops\":%ld,\"keys\":\"%s\",\"queue\":\"%s\",\"width\":%d,\"hot\":%.3f,"
+                "\"preload_ms\":%.1f,\"pending_after\":%zu,\"rss_kb\":%ld}\n",
+                config.seed, config.preload, config.operations, config.keys == KEYS_SEQUENTIAL ? "sequential" : "uniform",
+                queueKindName(config.queue), config.rangeWidth, config.hot, preloadMs, tree.size(), residentKb());
+
+    std::vector<std::uint32_t> all;
+    double total = 0;
+    for (int type = 0; type < types; ++type)
+    {
+        all.insert(all.end(), samples[type].begin(), samples[type].end());
+        total += totals[type];
+        printLatencyJson(names[type], samples[type], totals[type]);
+    }
+    printLatencyJson("all", all, total);
+}
+
+// Writes a generated workload as a gatorTaxi command file on stdout
+static void generateWorkload(const WorkloadConfig &config)
+{
+    WorkloadGenerator generator(config);
+    OutputWriter out;
+    out.open("-");
+    Command command;
+    while (generator.next(command))
+    {
+        std::string line = WorkloadGenerator::format(command);
+        out.write(line.data(), line.size());
+        out.put('\n');
+    }
+}
+
+// Point operations answered by the tree descent versus the hash index
+static void benchLookup(int maxRides)
+{
+    const int lookups = 1000000;
+    const IndexKind kinds[] = {INDEX_RBTREE, INDEX_BTREE};
+    OutputWriter sink;
+    sink.open("/dev/null");
+
+    std::printf("%11s %7s %5s %10s %10s %14s %10s %10s\n", "rides", "index", "hash", "hit_ns", "miss_ns", "ins_cancel_ns", "print_ns", "rss_kb");
+    for (long long n = 100000; n <= maxRides; n *= 10)
+    {
+        // Even ride numbers are present, odd ones are misses
+        std::vector<Ride> rides;
+        rides.reserve(n);
+        for (long long i = 0; i < n; ++i)
+        {
+            rides.push_back(Ride(static_cast<int>(2 * i), 1 + i % 1000, 1 + i % 997));
+        }
+        std::mt19937 rng(static_cast<std::uint32_t>(n));
+        std::vector<int> probes(lookups);
+        for (int &probe : probes)
+        {
+            probe = static_cast<int>(2 * (rng() % n));
+        }
+
+        for (IndexKind kind : kinds)
+        {
+            for (int hash = 0; hash < 2; ++hash)
+            {
+                std::unique_ptr<RideIndex> index;
+                if (kind == INDEX_BTREE)
+                    index.reset(new BPlusTree(n));
+                else
+                    index.reset(new RBTree(n));
+                index->appendSorted(rides);
+                if (hash)
+                    index->enableHashIndex(n);
+
+                long long found = 0;
+                Clock::time_point start = Clock::now();
+                for (int probe : probes)
+                {
+                    found += index->search(probe) != nullptr;
+                }
+                double hitNs = elapsedNs(start) / lookups;
+                start = Clock::now();
+                for (int probe : probes)
+                {
+                    found += index->search(probe + 1) != nullptr;
+                }
+                double missNs = elapsedNs(start) / lookups;
+
+                // Insert a missing ride and cancel it again, through the executor's own lookups
+                CommandExecutor executor(*index, sink, false);
+                Command insert;
+                insert.type = CMD_INSERT;
+                insert.args[1] = 500;
+                insert.args[2] = 500;
+                insert.argCount = 3;
+                Command cancel;
+                cancel.type = CMD_CANCEL_RIDE;
+                cancel.argCount = 1;
+                start = Clock::now();
+                for (int probe : probes)
+                {
+                    insert.args[0] = cancel.args[0] = probe + 1;
+                    executor.execute(insert);
+                    executor.execute(cancel);
+                }
+                double churnNs = elapsedNs(start) / lookups;
+
+                Command print;
+                print.type = CMD_PRINT;
+                print.argCount = 1;
+                start = Clock::now();
+                for (int probe : probes)
+                {
+                    print.args[0] = probe;
+                    executor.execute(print);
+                }
+                sink.flush();
+                double printNs = elapsedNs(start) / lookups;
+
+                std::printf("%11lld %7s %5s %10.1f %10.1f %14.1f %10.1f %10ld\n", n, indexKindName(kind), hash ? "yes" : "no", hitNs, missNs, churnNs,
+                            printNs, residentKb());
+                std::fflush(stdout);
+                if (found != lookups || index->size() != static_cast<std::size_t>(n))
+                {
+                    std::printf("lookup mismatch: %lld\n", found);
+                }
+            }
+        }
+    }
+}
+
+// Search-then-change versus the fused single-descent operations, on ascending and random keys
+static void benchFused(int rideCount)
+{
+    const IndexKind kinds[] = {INDEX_RBTREE, INDEX_BTREE};
+    const char *ops[] = {"insert", "update", "cancel"};
+
+    std::printf("%7s %10s %7s %12s %10s\n", "index", "keys", "op", "two_pass_ns", "fused_ns");
+    for (IndexKind kind : kinds)
+    {
+        for (int shuffled = 0; shuffled < 2; ++shuffled)
+        {
+            std::vector<int> keys(rideCount);
+            for (int i = 0; i < rideCount; ++i)
+            {
+                keys[i] = i;
+            }
+            if (shuffled)
+            {
+                std::mt19937 rng(42);
+                std::shuffle(keys.begin(), keys.end(), rng);
+            }
+
+            // Each way runs twice, alternating, and keeps its best time, as whichever runs first
+            // also pays for faulting in the node memory
+            double ns[3][2];
+            for (int run = 0; run < 4; ++run)
+            {
+                int fused = run % 2;
+                double took[3];
+                std::unique_ptr<RideIndex> index;
+                if (kind == INDEX_BTREE)
+                    index.reset(new BPlusTree(rideCount));
+                else
+                    index.reset(new RBTree(rideCount));
+
+                Clock::time_point start = Clock::now();
+                for (int key : keys)
+                {
+                    Ride ride(key, 1 + key % 1000, 2 + key % 997);
+                    if (fused)
+                        index->tryInsert(ride);
+                    else if (!index->search(key))
+                        index->insert(ride);
+                }
+                took[0] = elapsedNs(start) / rideCount;
+
+                // A shorter trip updates the ride in place
+                start = Clock::now();
+                for (int key : keys)
+                {
+                    if (fused)
+                        index->updateTrip(key, 1);
+                    else
+                        index->RideIndex::updateTrip(key, 1);
+                }
+                took[1] = elapsedNs(start) / rideCount;
+
+                start = Clock::now();
+                for (int key : keys)
+                {
+                    if (fused)
+                        index->cancelRide(key);
+                    else
+                        index->RideIndex::cancelRide(key);
+                }
+                took[2] = elapsedNs(start) / rideCount;
+
+                if (index->size() != 0)
+                {
+                    std::printf("rides left: %zu\n", index->size());
+                }
+                for (int op = 0; op < 3; ++op)
+                {
+                    if (run < 2 || took[op] < ns[op][fused])
+                        ns[op][fused] = took[op];
+                }
+            }
+            for (int op = 0; op < 3; ++op)
+            {
+                std::printf("%7s %10s %7s %12.1f %10.1f\n", indexKindName(kind), shuffled ? "random" : "ascending", ops[op], ns[op][0], ns[op][1]);
+            }
+            std::fflush(stdout);
+        }
+    }
+}
+
+// Prints every ride of the tree and then dispatches them all by GetNextRide, with ride numbers
+// shifted down by offset so trees of different widths can be compared
+template <class Key>
+static std::string describeTree(BasicRBTree<Key> &tree, Key offset)
+{
+    std::string text;
+    OutputWriter writer;
+    writer.openString(text);
+    tree.printRange(std::numeric_limits<Key>::min(), std::numeric_limits<Key>::max(), writer);
+    writer.put('\n');
+    while (!tree.minHeap->isEmpty())
+    {
+        typename BasicRBTree<Key>::Node *node = tree.minHeap->extractMin();
+        writer.writeInt(static_cast<long long>(node->ride.rideNumber - offset));
+        writer.put(' ');
+        tree.removeNode(node);
+    }
+    writer.close();
+    return text;
+}
+
+// Insert, search and GetNextRide cost of a tree of n rides numbered offset + 0..n-1
+template <class Key>
+static void benchKeyWidth(const char *name, int n, Key offset)
+{
+    std::mt19937 rng(n);
+    std::vector<Key> numbers(n);
+    for (int i = 0; i < n; ++i)
+    {
+        numbers[i] = offset + i;
+    }
+    std::shuffle(numbers.begin(), numbers.end(), rng);
+
+    BasicRBTree<Key> tree(n);
+    Clock::time_point start = Clock::now();
+    for (Key rideNumber : numbers)
+    {
+        tree.insert(BasicRide<Key>(rideNumber, rng() % 1000, 1 + rng() % 1000));
+    }
+    double insertNs = elapsedNs(start);
+
+    long long checksum = 0;
+    std::shuffle(numbers.begin(), numbers.end(), rng);
+    start = Clock::now();
+    for (Key rideNumber : numbers)
+    {
+        checksum += tree.search(rideNumber)->ride.rideCost;
+    }
+    double searchNs = elapsedNs(start);
+
+    start = Clock::now();
+    while (!tree.minHeap->isEmpty())
+    {
+        typename BasicRBTree<Key>::Node *node = tree.minHeap->extractMin();
+        checksum += node->ride.tripDuration;
+        tree.removeNode(node);
+    }
+    double nextNs = elapsedNs(start);
+
+    std::printf("%10d %6s %10zu %11.1f %11.1f %11.1f\n", n, name, sizeof(typename BasicRBTree<Key>::Node), insertNs / n, searchNs / n, nextNs / n);
+    std::fflush(stdout);
+    if (checksum < 0)
+    {
+        std::printf("unreachable\n");
+    }
+}
+
+// The queue operations of benchQueue on a heap with Arity children per slot
+template <int Arity>
+static void benchHeapArity(int n)
+{
+    const int ops = 1000000;
+    std::mt19937 rng(n);
+    std::vector<RBTNode> pool;
+    pool.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        pool.push_back(RBTNode(Ride(i, 1 + rng() % 1000, 1 + rng() % 1000), nullptr, nullptr, nullptr, BLACK));
+    }
+    BasicMinHeap<RBTNode, RideOrder, Arity> heap(100);
+    long long checksum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (RBTNode &node : pool)
+    {
+        heap.insert(&node);
+    }
+    double insertNs = elapsedNs(start);
+
+    start = Clock::now();
+    for (int i = 0; i < ops; ++i)
+    {
+        RBTNode *node = &pool[rng() % n];
+        node->ride.rideCost = 1 + rng() % 1000;
+        node->ride.tripDuration = 1 + rng() % 1000;
+        heap.update(node);
+    }
+    double updateNs = elapsedNs(start);
+
+    start = Clock::now();
+    for (int i = 0; i < ops; ++i)
+    {
+        RBTNode *node = heap.extractMin();
+        checksum += node->ride.rideNumber;
+        node->ride.rideCost = 1 + rng() % 1000;
+        heap.insert(node);
+    }
+    double churnNs = elapsedNs(start);
+
+    start = Clock::now();
+    while (!heap.isEmpty())
+    {
+        checksum += heap.extractMin()->ride.rideCost;
+    }
+    double extractNs = elapsedNs(start);
+
+    std::printf("%10d %6d %11.1f %11.1f %11.1f %11.1f\n", n, Arity, insertNs / n, updateNs / ops, churnNs / ops, extractNs / n);
+    std::fflush(stdout);
+    if (checksum < 0)
+    {
+        std::printf("unreachable\n");
+    }
+}
+
+// Ride number width of the tree and fan-out of the heap
+static void benchKeys(int maxRides)
+{
+    const long long offset = 1LL << 32;
+    std::vector<Ride> small;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 1000; ++i)
+    {
+        small.push_back(Ride(i, rng() % 10, 1 + rng() % 10));
+    }
+    RBTree narrow;
+    BasicRBTree<long long> wide;
+    for (const Ride &ride : small)
+    {
+        narrow.insert(ride);
+        wide.insert(BasicRide<long long>(offset + ride.rideNumber, ride.rideCost, ride.tripDuration));
+    }
+    std::string narrowText = describeTree(narrow, 0);
+    std::string wideText = describeTree(wide, offset);
+    bool printsWide = wideText.compare(0, 12, "(4294967296,") == 0;
+    bool sameOrder = narrowText.substr(narrowText.find('\n')) == wideText.substr(wideText.find('\n'));
+    std::printf("64-bit ride numbers print and dispatch like 32-bit: %s\n", printsWide && sameOrder ? "yes" : "NO");
+
+    std::printf("%10s %6s %10s %11s %11s %11s\n", "rides", "key", "node_bytes", "insert_ns", "search_ns", "next_ns");
+    for (int n = 100000; n <= maxRides; n *= 10)
+    {
+        benchKeyWidth<int>("int32", n, 0);
+        benchKeyWidth<long long>("int64", n, offset);
+    }
+
+    std::printf("%10s %6s %11s %11s %11s %11s\n", "rides", "arity", "insert_ns", "update_ns", "churn_ns", "extract_ns");
+    for (int n = 100000; n <= maxRides; n *= 10)
+    {
+        benchHeapArity<2>(n);
+        benchHeapArity<4>(n);
+        benchHeapArity<8>(n);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::printf("Usage: %s heap|queue|nodes|range|index [maxRides] | output [lines] | workload|generate [key=value ...] | shards [maxThreads] [shards] | snapshot [maxRides] | wal|rangecache [ops] | order [maxRides] | nextrides [rides] | parallelprint [rides] [maxThreads] | lookup [maxRides] | fused [rides] | keys [maxRides]\n", argv[0]);
+        return 1;
+    }
+
+    if (std::strcmp(argv[1], "heap") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 1000000;
+        benchHeap(maxRides);
+    }
+    else if (std::strcmp(argv[1], "queue") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 1000000;
+        benchQueue(maxRides);
+    }
+    else if (std::strcmp(argv[1], "nodes") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 1000000;
+        benchNodes(maxRides);
+    }
+    else if (std::strcmp(argv[1], "output") == 0)
+    {
+        int lines = argc > 2 ? std::atoi(argv[2]) : 2000000;
+        benchOutput(lines);
+    }
+    else if (std::strcmp(argv[1], "range") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 1000000;
+        benchRange(maxRides);
+    }
+    else if (std::strcmp(argv[1], "shards") == 0)
+    {
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        int maxThreads = argc > 2 ? std::atoi(argv[2]) : std::max(1, cores);
+        int shardCount = argc > 3 ? std::atoi(argv[3]) : 64;
+        benchShards(std::max(1, maxThreads), shardCount);
+    }
+    else if (std::strcmp(argv[1], "index") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 10000000;
+        benchIndex(maxRides);
+    }
+    else if (std::strcmp(argv[1], "snapshot") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 10000000;
+        benchSnapshot(maxRides);
+    }
+    else if (std::strcmp(argv[1], "wal") == 0)
+    {
+        long operations = argc > 2 ? std::atol(argv[2]) : 200000;
+        benchWal(operations);
+    }
+    else if (std::strcmp(argv[1], "rangecache") == 0)
+    {
+        long operations = argc > 2 ? std::atol(argv[2]) : 1000000;
+        benchRangeCache(operations);
+    }
+    else if (std::strcmp(argv[1], "order") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 10000000;
+        benchOrder(maxRides);
+    }
+    else if (std::strcmp(argv[1], "nextrides") == 0)
+    {
+        int rideCount = argc > 2 ? std::atoi(argv[2]) : 1000000;
+        benchNextRides(rideCount);
+    }
+    else if (std::strcmp(argv[1], "parallelprint") == 0)
+    {
+        int rideCount = argc > 2 ? std::atoi(argv[2]) : 4000000;
+        int maxThreads = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(WorkStealingPool::defaultThreads());
+        benchParallelPrint(rideCount, static_cast<unsigned>(std::max(1, maxThreads)));
+    }
+    else if (std::strcmp(argv[1], "lookup") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 10000000;
+        benchLookup(maxRides);
+    }
+    else if (std::strcmp(argv[1], "fused") == 0)
+    {
+        int rideCount = argc > 2 ? std::atoi(argv[2]) : 1000000;
+        benchFused(rideCount);
+    }
+    else if (std::strcmp(argv[1], "keys") == 0)
+    {
+        int maxRides = argc > 2 ? std::atoi(argv[2]) : 10000000;
+        benchKeys(maxRides);
+    }
+    else if (std::strcmp(argv[1], "workload") == 0 || std::strcmp(argv[1], "generate") == 0)
+    {
+        WorkloadConfig config;
+        if (!parseWorkloadConfig(argc, argv, config))
+        {
+            return 1;
+        }
+        if (argv[1][0] == 'w')
+            benchWorkload(config);
+        else
+            generateWorkload(config);
+    }
+    else
+    {
+        std::printf("Unknown benchmark: %s\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
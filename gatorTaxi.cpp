@@ -4,744 +4,793 @@
 // Description: This program is a simulation of a taxi service. It reads in a file of taxi rides and stores them in a red-black tree. It then reads in a file of commands and executes them. The commands are: Insert, Print, GetNextRide, UpdateRide and CancelRide. The program outputs the results of the commands to an output file.
 // The program is written in C++ and uses the following data structures: Red-Black Tree, Min Heap, and a custom class called Ride.
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
-#include <algorithm>
-#include <limits>
 
-// Ride class
-class Ride
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "BPlusTree.h"
+#include "CommandExecutor.h"
+#include "CommandParser.h"
+#include "CommandPipeline.h"
+#include "InputSource.h"
+#include "OutputWriter.h"
+#include "ParallelRangePrinter.h"
+#include "RBTree.h"
+#include "RangeCache.h"
+#include "RideIndex.h"
+#include "RideQueue.h"
+#include "Snapshot.h"
+#include "Stats.h"
+#include "WorkStealingPool.h"
+#include "WriteAheadLog.h"
+
+static void printUsage(const char *program)
 {
-public:
-    int rideNumber = 0;
-    int rideCost = 0;
-    int tripDuration = 0;
+    std::cout << "Usage: " << program << " [--reserve N] [--queue KIND] [--ride-number-ties] [--index KIND] [--hash-index]" << std::endl;
+    std::cout << "       [--range-cache N] [--no-mmap] [-o output_file]" << std::endl;
+    std::cout << "       [--stats stats_file] [--print-threads N [--print-parallel-min N]]" << std::endl;
+    std::cout << "       [--snapshot snapshot_file] [--restore snapshot_file] [--wal log_file [--wal-bytes N] [--wal-window US]]" << std::endl;
+    std::cout << "       [--serve] file_name | --listen socket_path" << std::endl;
+    std::cout << "   or: " << program << " --replay [--jobs N] [-o output_dir] [--reserve N] [--queue KIND] [--ride-number-ties]" << std::endl;
+    std::cout << "       [--index KIND] [--hash-index] [--range-cache N] [--no-mmap] file_or_directory..." << std::endl;
+    std::cout << "  file_name    command file, or - to read commands from stdin" << std::endl;
+    std::cout << "  --serve      long-running mode: parse ahead on a reader thread and write each response as" << std::endl;
+    std::cout << "               soon as no command is waiting; file_name defaults to - (stdin)" << std::endl;
+    std::cout << "  --listen PATH    serve clients of a local Unix domain socket one connection at a time," << std::endl;
+    std::cout << "               each getting its own responses, all sharing the same rides" << std::endl;
+    std::cout << "  --replay     run many command files, or every file in the given directories but *.out," << std::endl;
+    std::cout << "               each through its own rides on a work-stealing thread pool; the results of" << std::endl;
+    std::cout << "               NAME go to output_dir/NAME.out (default output_dir .)" << std::endl;
+    std::cout << "  --jobs N     worker threads for --replay (default: one per hardware thread, at most four" << std::endl;
+    std::cout << "               per hardware thread)" << std::endl;
+    std::cout << "  -o FILE      where to write results (default output_file.txt), - for stdout" << std::endl;
+    std::cout << "  --reserve N  initial Min Heap reservation in rides (default 100), the heap grows past it as needed" << std::endl;
+    std::cout << "  --queue KIND priority queue behind GetNextRide: binary (default), pairing, bucket" << std::endl;
+    std::cout << "               or packed; all but binary order rides of equal cost and duration by ride number" << std::endl;
+    std::cout << "  --ride-number-ties   have the binary queue order rides of equal cost and duration by" << std::endl;
+    std::cout << "               ride number too, instead of the order its layout gives; this changes which" << std::endl;
+    std::cout << "               of them GetNextRide returns first, and lets long Insert runs be heapified in bulk" << std::endl;
+    std::cout << "  --index KIND ordered index on ride number: rbtree (default) or btree" << std::endl;
+    std::cout << "  --hash-index also keep a hash table from ride number to ride, so Insert duplicate" << std::endl;
+    std::cout << "               checks, CancelRide, UpdateTrip and Print(x) skip the tree descent" << std::endl;
+    std::cout << "  --range-cache N  keep the output of up to N Print(r1,r2) ranges until a ride in them" << std::endl;
+    std::cout << "               changes (default 0, off)" << std::endl;
+    std::cout << "  --no-mmap    read regular files in chunks instead of memory-mapping them" << std::endl;
+    std::cout << "  --print-threads N    format Print(r1,r2) ranges of many rides on N threads (default 1," << std::endl;
+    std::cout << "               0 for one per hardware thread, at most four per hardware thread); the" << std::endl;
+    std::cout << "               output is the same either way; not with --replay" << std::endl;
+    std::cout << "  --print-parallel-min N   rides a range needs before it is split up (default 65536)" << std::endl;
+    std::cout << "  --stats FILE write per-command latency and tree/heap statistics at exit and on SIGUSR1," << std::endl;
+    std::cout << "               - for stderr (only in builds with -DGATORTAXI_STATS, see make gatorTaxiStats)" << std::endl;
+    std::cout << "  --snapshot FILE  where Snapshot() commands write the binary ride image (default" << std::endl;
+    std::cout << "               gatorTaxi.snapshot); also taken on SIGUSR2 when given" << std::endl;
+    std::cout << "  --restore FILE   load a snapshot, skip the commands it already covers and continue" << std::endl;
+    std::cout << "               the output file from where the snapshot was taken; not with --wal" << std::endl;
+    std::cout << "  --wal FILE   replay the write-ahead log FILE into the rides, then log every applied" << std::endl;
+    std::cout << "               Insert, UpdateTrip, CancelRide and GetNextRide to it; commands must come" << std::endl;
+    std::cout << "               from a pipe, fifo, terminal or --listen, whose input is not read again on restart" << std::endl;
+    std::cout << "  --wal-bytes N    sync the log once N bytes of records are pending (default 65536)" << std::endl;
+    std::cout << "  --wal-window US  or once the oldest pending record is US microseconds old (default" << std::endl;
+    std::cout << "               2000, 0 syncs every record)" << std::endl;
+}
 
-    Ride(int rideNumber, int rideCost, int tripDuration) : rideNumber(rideNumber), rideCost(rideCost), tripDuration(tripDuration) {}
+// Parses a non-negative decimal integer option value
+static bool parseCount(const char *text, long long &value)
+{
+    char *end = nullptr;
+    value = std::strtoll(text, &end, 10);
+    return *text != '\0' && *end == '\0' && value >= 0;
+}
 
-    // Overloaded comparison operators
-    int compareTo(const Ride &other) const
-    {
-        if (rideCost == other.rideCost)
-        {
-            return tripDuration - other.tripDuration;
-        }
-        return rideCost - other.rideCost;
-    }
+static RideIndex *createIndex(IndexKind indexKind, std::size_t heapReserve, QueueKind queueKind, bool rideNumberTies, bool hashIndex)
+{
+    RideIndex *rides;
+    if (indexKind == INDEX_BTREE)
+        rides = new BPlusTree(heapReserve, queueKind, rideNumberTies);
+    else
+        rides = new RBTree(heapReserve, queueKind, rideNumberTies);
+    if (hashIndex)
+        rides->enableHashIndex(heapReserve);
+    return rides;
+}
 
-    // Overloaded output operator
-    std::string toString() const
-    {
-        std::ostringstream oss;
-        oss << "(" << rideNumber << "," << rideCost << "," << tripDuration << ")";
-        return oss.str();
-    }
+// Engine settings shared by every file of a --replay run
+struct ReplayOptions
+{
+    std::size_t heapReserve;
+    std::size_t rangeCacheSize;
+    QueueKind queueKind;
+    bool rideNumberTies;
+    IndexKind indexKind;
+    bool hashIndex;
+    bool allowMap;
 };
 
-// Min Heap class for storing the rides in order of cost and duration
-class MinHeap
+// What one file of a --replay run did; error is empty when it ran to the end
+struct ReplayResult
 {
-private:
-    std::vector<Ride> heap;
-    int size;
-
-    int parent(int i) { return (i - 1) / 2; }
-    int left(int i) { return 2 * i + 1; }
-    int right(int i) { return 2 * i + 2; }
-
-    void siftUp(int i);
-    void siftDown(int i);
-
-public:
-    MinHeap(int capacity) : size(0) { heap.reserve(capacity); }
-
-    bool isEmpty() const { return size == 0; }
-    Ride getMin() const { return heap[0]; }
-    void insert(const Ride &ride);
-    Ride extractMin();
-    void remove(const Ride &ride);
+    std::uint64_t commands = 0;
+    std::uint64_t bytes = 0;
+    std::string error;
 };
 
-// siftUp function for the Min Heap
-void MinHeap::siftUp(int i)
+// Runs the command file inputName through rides of its own and writes the results to
+// outputName, exactly as a separate gatorTaxi process would
+static ReplayResult replayFile(const std::string &inputName, const std::string &outputName, const ReplayOptions &options)
 {
-    while (i > 0 && heap[parent(i)].compareTo(heap[i]) > 0)
+    ReplayResult result;
+    InputSource input;
+    if (!input.open(inputName, options.allowMap))
     {
-        std::swap(heap[parent(i)], heap[i]);
-        i = parent(i);
+        result.error = "Error opening file: " + inputName + ": " + input.lastError();
+        return result;
     }
-}
-
-// siftDown function for the Min Heap
-void MinHeap::siftDown(int i)
-{
-    int minIndex = i;
-    int l = left(i);
-    if (l < size && heap[l].compareTo(heap[minIndex]) < 0)
+    OutputWriter output;
+    if (!output.open(outputName))
     {
-        minIndex = l;
+        result.error = "Error opening file: " + outputName + ": " + output.lastError();
+        return result;
     }
 
-    int r = right(i);
-    if (r < size && heap[r].compareTo(heap[minIndex]) < 0)
+    std::unique_ptr<RideIndex> rides(createIndex(options.indexKind, options.heapReserve, options.queueKind, options.rideNumberTies, options.hashIndex));
+    CommandExecutor executor(*rides, output);
+    RangeCache rangeCache(options.rangeCacheSize);
+    if (rangeCache.isEnabled())
     {
-        minIndex = r;
+        executor.rangeCache = &rangeCache;
     }
 
-    if (i != minIndex)
+    // Parse errors of one file are reported together, so files do not interleave on stderr
+    std::string warnings;
+    const char *lineBegin;
+    const char *lineEnd;
+    Command command;
+    const char *error = nullptr;
+    long lineNumber = 0;
+    while (input.nextLine(lineBegin, lineEnd))
     {
-        std::swap(heap[i], heap[minIndex]);
-        siftDown(minIndex);
+        ++lineNumber;
+        ParseResult parsed = CommandParser::parse(lineBegin, lineEnd, command, error);
+        if (parsed == PARSE_EMPTY)
+        {
+            continue;
+        }
+        if (parsed == PARSE_ERROR)
+        {
+            warnings += inputName + ":" + std::to_string(lineNumber) + ": " + error + ": " + std::string(lineBegin, lineEnd) + "\n";
+            continue;
+        }
+        ++result.commands;
+        if (!executor.execute(command))
+        {
+            break;
+        }
     }
-}
-
-// insert function for the Min Heap
-void MinHeap::insert(const Ride &ride)
-{
-    if (size == heap.capacity())
+    executor.finish();
+    result.bytes = input.position();
+    if (!warnings.empty())
     {
-        throw std::overflow_error("Max capacity reached");
+        std::fwrite(warnings.data(), 1, warnings.size(), stderr);
     }
 
-    heap.push_back(ride);
-    siftUp(size++);
-}
-
-// extractMin function for the Min Heap
-Ride MinHeap::extractMin()
-{
-    if (isEmpty())
+    if (!input.lastError().empty())
     {
-        throw std::underflow_error("No elements in the heap");
+        result.error = "Error reading " + inputName + ": " + input.lastError();
+    }
+    output.close();
+    if (!output.lastError().empty() && result.error.empty())
+    {
+        result.error = "Error writing " + outputName + ": " + output.lastError();
     }
-
-    Ride result = heap[0];
-    heap[0] = heap[--size];
-    heap.pop_back();
-    siftDown(0);
-
     return result;
 }
 
-// remove function for the Min Heap
-void MinHeap::remove(const Ride &ride)
+// Expands directories to the regular files in them, in name order and without *.out results;
+// false with a message on stdout if a path cannot be read
+static bool collectReplayInputs(const std::vector<std::string> &paths, std::vector<std::string> &files)
 {
-    int i = 0;
-    for (; i < size; ++i)
+    for (const std::string &path : paths)
     {
-        if (heap[i].rideNumber == ride.rideNumber)
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
         {
-            break;
+            std::cout << "Error opening file: " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
         }
+        if (!S_ISDIR(info.st_mode))
+        {
+            files.push_back(path);
+            continue;
+        }
+
+        DIR *directory = opendir(path.c_str());
+        if (!directory)
+        {
+            std::cout << "Error opening directory: " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        std::vector<std::string> names;
+        while (dirent *entry = readdir(directory))
+        {
+            std::string name = entry->d_name;
+            std::string full = path + "/" + name;
+            if (name[0] == '.' || (name.size() > 4 && name.compare(name.size() - 4, 4, ".out") == 0))
+                continue;
+            if (stat(full.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+                names.push_back(full);
+        }
+        closedir(directory);
+        std::sort(names.begin(), names.end());
+        files.insert(files.end(), names.begin(), names.end());
     }
-    if (i >= size)
-    {
-        return;
-    }
-    heap[i] = heap[--size];
-    heap.pop_back();
-    siftDown(i);
-    siftUp(i);
+    return true;
 }
 
-enum Color
+// --replay: every file through its own engine on the pool; returns the exit code
+static int replay(const std::vector<std::string> &paths, const std::string &outputDir, unsigned jobs, const ReplayOptions &options)
 {
-    RED,
-    BLACK
-};
-
-// Red-Black Tree class for storing the rides in order of ride number
-class RBTNode
-{
-public:
-    Ride ride;
-    RBTNode *left;
-    RBTNode *right;
-    RBTNode *parent;
-    Color color;
-
-    RBTNode(Ride ride, RBTNode *parent, RBTNode *left, RBTNode *right, Color color) : ride(ride), left(left), right(right), parent(parent), color(color) {}
-};
-
-class RBTree
-{
-public:
-    RBTNode *root;
-    MinHeap *minHeap;
-
-    RBTree()
+    std::vector<std::string> files;
+    if (!collectReplayInputs(paths, files))
     {
-        root = nullptr;
-        minHeap = new MinHeap(100);
+        return 1;
     }
 
-    ~RBTree()
+    // Results are named after the input, so two inputs with the same name would overwrite each other
+    std::vector<std::string> outputs;
+    std::set<std::string> taken;
+    for (const std::string &file : files)
     {
-        deleteTree(root);
-        delete minHeap;
+        std::string::size_type slash = file.find_last_of('/');
+        std::string output = outputDir + "/" + (slash == std::string::npos ? file : file.substr(slash + 1)) + ".out";
+        if (!taken.insert(output).second)
+        {
+            std::cout << "Two inputs would both write " << output << std::endl;
+            return 1;
+        }
+        outputs.push_back(output);
     }
 
-    void insert(Ride ride)
+    // Largest files first, so the pool deals every worker a similar share
+    std::vector<std::size_t> order(files.size());
+    std::vector<off_t> sizes(files.size(), 0);
+    for (std::size_t i = 0; i < files.size(); ++i)
     {
-        RBTNode *newNode = new RBTNode(ride, nullptr, nullptr, nullptr, RED);
-        insert(newNode);
-        minHeap->insert(ride);
+        struct stat info;
+        if (stat(files[i].c_str(), &info) == 0)
+            sizes[i] = info.st_size;
+        order[i] = i;
     }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return sizes[a] > sizes[b]; });
+
+    std::vector<ReplayResult> results(files.size());
+    WorkStealingPool pool(jobs);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pool.run(order.size(), [&](std::size_t task, std::size_t)
+             {
+                 std::size_t file = order[task];
+                 results[file] = replayFile(files[file], outputs[file], options);
+             });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-    RBTNode *search(int rideNumber)
+    std::uint64_t commands = 0;
+    std::uint64_t bytes = 0;
+    std::size_t failed = 0;
+    for (const ReplayResult &result : results)
     {
-        RBTNode *current = root;
-        while (current && current->ride.rideNumber != rideNumber)
+        commands += result.commands;
+        bytes += result.bytes;
+        if (!result.error.empty())
         {
-            if (rideNumber < current->ride.rideNumber)
-            {
-                current = current->left;
-            }
-            else
-            {
-                current = current->right;
-            }
+            std::cerr << result.error << std::endl;
+            ++failed;
         }
-        return current;
     }
+    unsigned threads = std::min<std::size_t>(pool.threadCount(), files.size());
+    std::cout << "Replayed " << files.size() - failed << " of " << files.size() << " files on " << threads << " threads in " << seconds << " s: " << commands
+              << " commands (" << (seconds > 0 ? commands / seconds : 0) << "/s), " << bytes / 1e6 << " MB (" << (seconds > 0 ? bytes / 1e6 / seconds : 0)
+              << " MB/s), " << pool.stealCount() << " stolen" << std::endl;
+    return failed ? 1 : 0;
+}
 
-    void printRange(int rideNumber, std::ofstream &outputFile)
+// Serves connections on a Unix domain socket at path one after another, each through
+// session(InputSource &) with its responses written back on the connection, until a session
+// stops the run; returns the exit code
+template <class Session>
+static int listen(const std::string &path, InputSource &input, OutputWriter &output, Session session)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
     {
-        RBTNode *result = search(rideNumber);
-        if (result)
-        {
-            outputFile << result->ride.toString() << std::endl;
-        }
-        else
-        {
-            outputFile << "(0,0,0)" << std::endl;
-        }
+        std::cout << "Socket path too long: " << path << std::endl;
+        return 1;
     }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
 
-    void printRange(int rideNumber1, int rideNumber2, std::ofstream &outputFile)
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (server < 0 || bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(server, 16) != 0)
     {
-        bool printed = false;
-        if (!printRangeHelper(root, rideNumber1, rideNumber2, outputFile, printed))
-        {
-            outputFile << "(0,0,0)";
-        }
+        std::cout << "Error listening on " << path << ": " << std::strerror(errno) << std::endl;
+        if (server >= 0)
+            ::close(server);
+        return 1;
     }
+    // A client that disconnects early must not take the server down with it
+    std::signal(SIGPIPE, SIG_IGN);
 
-    void remove(Ride ride)
+    int exitCode = 0;
+    while (true)
     {
-        RBTNode *node = search(ride.rideNumber);
-        if (node)
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Error accepting on " << path << ": " << std::strerror(errno) << std::endl;
+            exitCode = 1;
+            break;
+        }
+        int reply = dup(client);
+        input.attach(client);
+        output.attach(reply);
+        bool more = session(input);
+        input.close();
+        output.close();
+        if (!more)
         {
-            minHeap->remove(ride);
-            removeNode(node);
+            break;
         }
     }
+    ::close(server);
+    ::unlink(path.c_str());
+    return exitCode;
+}
 
-    void removeNode(RBTNode *node)
-    {
-        RBTNode *y = node;
-        Color yOriginalColor = y->color;
-        RBTNode *x = nullptr; // Initialize x to nullptr to avoid uninitialized usage later
-
-        // If node has no left child, replace node with its right child
-        if (!node->left)
-        {
-            x = node->right;
-            transplant(node, node->right);
-        } // If node has no right child, replace node with its left child
-        else if (!node->right)
-        {
-            x = node->left;
-            transplant(node, node->left);
-        } // If node has both left and right children, replace node with its successor
-        else
-        {
-            y = minimum(node->right);
-            yOriginalColor = y->color;
-            x = y->right;
-            // If successor is a direct child of node, replace successor with its right child
-            if (y->parent == node)
+// Main function
+int main(int argc, char *argv[])
+{
+    std::string fileName;
+    std::string outputFileName = "output_file.txt";
+    std::size_t heapReserve = 100;
+    std::size_t rangeCacheSize = 0;
+    QueueKind queueKind = QUEUE_BINARY;
+    bool rideNumberTies = false;
+    IndexKind indexKind = INDEX_RBTREE;
+    bool hashIndex = false;
+    bool allowMap = true;
+    std::string statsFileName;
+    std::string snapshotFileName;
+    std::string restoreFileName;
+    std::string walFileName;
+    bool serve = false;
+    std::string listenPath;
+    bool replayMode = false;
+    bool outputGiven = false;
+    unsigned replayJobs = 0;
+    std::vector<std::string> replayPaths;
+    long long printThreads = 1;
+    bool printThreadsGiven = false;
+    // More threads than this only adds scheduling and start-up cost
+    const long long maxThreads = 4LL * WorkStealingPool::defaultThreads();
+    std::size_t printParallelMin = ParallelRangePrinter::DEFAULT_MIN_RIDES;
+    std::size_t walBytes = WriteAheadLog::DEFAULT_GROUP_BYTES;
+    std::uint64_t walWindowMicros = WriteAheadLog::DEFAULT_WINDOW_MICROS;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if ((arg == "--reserve" || arg == "--wal-bytes" || arg == "--wal-window" || arg == "--range-cache" || arg == "--jobs" || arg == "--print-threads" ||
+             arg == "--print-parallel-min") && i + 1 < argc)
+        {
+            long long value;
+            if (!parseCount(argv[++i], value))
             {
-                if (x)
-                    x->parent = y;
+                std::cout << "Invalid " << arg << " value: " << argv[i] << std::endl;
+                return 1;
             }
-            // If successor is not a direct child of node, replace successor with its right child and replace successor's parent with successor's right child
-            else
+            if (arg == "--reserve")
+                heapReserve = static_cast<std::size_t>(value);
+            else if (arg == "--range-cache")
+                rangeCacheSize = static_cast<std::size_t>(value);
+            else if (arg == "--jobs" || arg == "--print-threads")
             {
-                transplant(y, y->right);
-                y->right = node->right;
-                y->right->parent = y;
+                if (value > maxThreads)
+                {
+                    std::cout << "Invalid " << arg << " value: " << argv[i] << " (at most " << maxThreads << ")" << std::endl;
+                    return 1;
+                }
+                if (arg == "--jobs")
+                {
+                    replayJobs = static_cast<unsigned>(value);
+                }
+                else
+                {
+                    printThreads = value;
+                    printThreadsGiven = true;
+                }
             }
-            // Replace node with successor
-            transplant(node, y);
-            y->left = node->left;
-            y->left->parent = y;
-            y->color = node->color;
+            else if (arg == "--print-parallel-min")
+                printParallelMin = static_cast<std::size_t>(value);
+            else if (arg == "--wal-bytes")
+                walBytes = static_cast<std::size_t>(value);
+            else
+                walWindowMicros = static_cast<std::uint64_t>(value);
         }
-
-        // If successor is black, fix the tree
-        if (yOriginalColor == BLACK)
+        else if (arg == "--queue" && i + 1 < argc)
         {
-            removeFixup(x);
+            if (!parseQueueKind(argv[++i], queueKind))
+            {
+                std::cout << "Invalid --queue value: " << argv[i] << std::endl;
+                return 1;
+            }
         }
-        delete node;
-    }
-
-    void updateTrip(int rideNumber, int newTripDuration)
-    {
-        RBTNode *node = search(rideNumber);
-        if (!node)
-            return;
-
-        int old_tripDuration = node->ride.tripDuration;
-
-        // If new trip duration is less than or equal to old trip duration, update the trip duration and heap
-        if (newTripDuration <= old_tripDuration)
+        else if (arg == "--index" && i + 1 < argc)
         {
-            minHeap->remove(node->ride);
-            node->ride.tripDuration = newTripDuration;
-            minHeap->insert(node->ride);
-            return;
-        } // If new trip duration is less than or equal to twice the old trip duration, update the trip duration, cost and heap
-        else if (newTripDuration <= 2 * old_tripDuration)
-        {
-            minHeap->remove(node->ride);
-            node->ride.tripDuration = newTripDuration;
-            node->ride.rideCost += 10;
-            minHeap->insert(node->ride);
-        } // If new trip duration is greater than twice the old trip duration, cancel the ride
-        else
+            if (!parseIndexKind(argv[++i], indexKind))
+            {
+                std::cout << "Invalid --index value: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if ((arg == "-o" || arg == "--output") && i + 1 < argc)
         {
-            minHeap->remove(node->ride);
-            remove(node->ride);
+            outputFileName = argv[++i];
+            outputGiven = true;
         }
-    }
-
-    void cancelRide(int rideNumber)
-    {
-        RBTNode *node = search(rideNumber);
-        if (!node)
-            return;
-
-        minHeap->remove(node->ride);
-        remove(node->ride);
-    }
-
-private:
-    void insert(RBTNode *newNode)
-    {
-        // Insert node in the tree
-        RBTNode *current = root;
-        RBTNode *parent = nullptr;
-
-        while (current)
+        else if (arg == "--stats" && i + 1 < argc)
         {
-            parent = current;
-            if (newNode->ride.rideNumber < current->ride.rideNumber)
-            {
-                current = current->left;
-            }
-            else
-            {
-                current = current->right;
-            }
+            statsFileName = argv[++i];
         }
-
-        newNode->parent = parent;
-
-        if (!parent)
+        else if (arg == "--snapshot" && i + 1 < argc)
         {
-            root = newNode;
+            snapshotFileName = argv[++i];
         }
-        else if (newNode->ride.rideNumber < parent->ride.rideNumber)
+        else if (arg == "--restore" && i + 1 < argc)
         {
-            parent->left = newNode;
+            restoreFileName = argv[++i];
         }
-        else
+        else if (arg == "--wal" && i + 1 < argc)
         {
-            parent->right = newNode;
+            walFileName = argv[++i];
         }
-
-        // Fix Red-Black Tree properties
-        newNode->color = RED;
-
-        insertFixup(newNode);
-    }
-
-    void insertFixup(RBTNode *node)
-    {
-        // If node is root, color it black and return
-        while (node->parent && node->parent->color == RED)
+        else if (arg == "--serve")
         {
-            // If parent of node is left child of grandparent of node
-            if (node->parent == node->parent->parent->left)
-            {
-                RBTNode *uncle = node->parent->parent->right;
-
-                // If uncle of node is red, recolor parent, uncle and grandparent of node
-                if (uncle && uncle->color == RED)
-                {
-                    node->parent->color = BLACK;
-                    uncle->color = BLACK;
-                    node->parent->parent->color = RED;
-                    node = node->parent->parent;
-                } // If uncle of node is black, rotate the tree
-                else
-                {
-                    // If node is right child of parent, rotate left at parent
-                    if (node == node->parent->right)
-                    {
-                        node = node->parent;
-                        leftRotate(node);
-                    }
-                    node->parent->color = BLACK;
-                    node->parent->parent->color = RED;
-                    rightRotate(node->parent->parent);
-                }
-            } // If parent of node is right child of grandparent of node
-            else
-            {
-                RBTNode *uncle = node->parent->parent->left;
-
-                // If uncle of node is red, recolor parent, uncle and grandparent of node
-                if (uncle && uncle->color == RED)
-                {
-                    node->parent->color = BLACK;
-                    uncle->color = BLACK;
-                    node->parent->parent->color = RED;
-                    node = node->parent->parent;
-                }
-                else // If uncle of node is black, rotate the tree
-                {
-                    // If node is left child of parent, rotate right at parent
-                    if (node == node->parent->left)
-                    {
-                        node = node->parent;
-                        rightRotate(node);
-                    }
-                    node->parent->color = BLACK;
-                    node->parent->parent->color = RED;
-                    leftRotate(node->parent->parent);
-                }
-            }
+            serve = true;
         }
-        root->color = BLACK;
-    }
-
-    void leftRotate(RBTNode *x)
-    {
-        RBTNode *y = x->right;
-        x->right = y->left;
-
-        if (y->left)
+        else if (arg == "--listen" && i + 1 < argc)
         {
-            y->left->parent = x;
+            listenPath = argv[++i];
         }
-
-        y->parent = x->parent;
-
-        if (!x->parent)
+        else if (arg == "--ride-number-ties")
         {
-            root = y;
+            rideNumberTies = true;
         }
-        else if (x == x->parent->left)
+        else if (arg == "--hash-index")
         {
-            x->parent->left = y;
+            hashIndex = true;
         }
-        else
+        else if (arg == "--no-mmap")
         {
-            x->parent->right = y;
+            allowMap = false;
         }
-
-        y->left = x;
-        x->parent = y;
-    }
-
-    void rightRotate(RBTNode *y)
-    {
-        RBTNode *x = y->left;
-        y->left = x->right;
-
-        if (x->right)
+        else if (arg == "--replay")
         {
-            x->right->parent = y;
+            replayMode = true;
         }
-
-        x->parent = y->parent;
-
-        if (!y->parent)
+        else if (replayMode && arg.compare(0, 2, "--") != 0)
         {
-            root = x;
+            replayPaths.push_back(arg);
         }
-        else if (y == y->parent->right)
+        else if (fileName.empty() && arg.compare(0, 2, "--") != 0)
         {
-            y->parent->right = x;
+            fileName = arg;
         }
         else
         {
-            y->parent->left = x;
+            printUsage(argv[0]);
+            return 1;
         }
-
-        x->right = y;
-        y->parent = x;
     }
 
-    void transplant(RBTNode *oldNode, RBTNode *newNode)
+    if (replayMode)
     {
-        if (!oldNode->parent)
+        // Paths given before --replay was seen
+        if (!fileName.empty())
+            replayPaths.insert(replayPaths.begin(), fileName);
+        // Files already run in parallel, one per --jobs thread
+        if (serve || !listenPath.empty() || !restoreFileName.empty() || !walFileName.empty() || !snapshotFileName.empty() || !statsFileName.empty() ||
+            printThreadsGiven)
         {
-            root = newNode;
+            std::cout << "--replay cannot be combined with --serve, --listen, --restore, --wal, --snapshot, --stats or --print-threads" << std::endl;
+            return 1;
         }
-        else if (oldNode == oldNode->parent->left)
+        if (replayPaths.empty())
         {
-            oldNode->parent->left = newNode;
+            printUsage(argv[0]);
+            return 1;
         }
-        else
+        ReplayOptions options = {heapReserve, rangeCacheSize, queueKind, rideNumberTies, indexKind, hashIndex, allowMap};
+        return replay(replayPaths, outputGiven ? outputFileName : ".", replayJobs, options);
+    }
+
+    if (serve && fileName.empty())
+    {
+        fileName = "-";
+    }
+    if (!listenPath.empty() && (!fileName.empty() || !restoreFileName.empty()))
+    {
+        std::cout << "--listen takes its commands from the socket and cannot be combined with file_name or --restore" << std::endl;
+        return 1;
+    }
+    // The log holds every mutation since the start, the snapshot's among them, and the commands
+    // after the snapshot are read again from the input, so the two cannot be stacked
+    if (!walFileName.empty() && !restoreFileName.empty())
+    {
+        std::cout << "--wal cannot be combined with --restore" << std::endl;
+        return 1;
+    }
+    if (fileName.empty() && listenPath.empty())
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+#ifdef GATORTAXI_STATS
+    if (statsFileName.empty())
+    {
+        statsFileName = "-";
+    }
+#else
+    if (!statsFileName.empty())
+    {
+        std::cout << "--stats needs a build with -DGATORTAXI_STATS (make gatorTaxiStats)" << std::endl;
+        return 1;
+    }
+#endif
+
+    InputSource inputFile;
+    if (listenPath.empty() && !inputFile.open(fileName, allowMap))
+    {
+        std::cout << "Error opening file: " << fileName << ": " << inputFile.lastError() << std::endl;
+        return 1;
+    }
+    // The log already holds the mutations of every command read before a restart, and a file
+    // would be read and applied again from its first line
+    if (!walFileName.empty() && listenPath.empty() && inputFile.isRegularFile())
+    {
+        std::cout << "--wal needs commands from a pipe, fifo, terminal or --listen, not a regular file: " << fileName << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<RideIndex> rides(createIndex(indexKind, heapReserve, queueKind, rideNumberTies, hashIndex));
+
+    long lineNumber = 0;
+    OutputWriter outputFile;
+    bool outputOpened;
+    if (!restoreFileName.empty())
+    {
+        Snapshot image;
+        if (!image.open(restoreFileName))
         {
-            oldNode->parent->right = newNode;
+            std::cout << "Error loading snapshot: " << restoreFileName << ": " << image.lastError() << std::endl;
+            return 1;
         }
-
-        if (newNode)
+        rides->appendSorted(image.rides(), image.rideCount());
+        Snapshot::Position position = image.position();
+        if (!inputFile.skipTo(position.inputOffset))
         {
-            newNode->parent = oldNode->parent;
+            std::cout << "Error restoring " << restoreFileName << ": " << fileName << " ends before the snapshot was taken" << std::endl;
+            return 1;
         }
+        lineNumber = static_cast<long>(position.inputLine);
+        outputOpened = outputFile.openAt(outputFileName, position.outputOffset);
+    }
+    else
+    {
+        // Connections get their responses on the socket instead
+        outputOpened = !listenPath.empty() || outputFile.open(outputFileName);
+    }
+    if (!outputOpened)
+    {
+        std::cout << "Error opening file: " << outputFileName << ": " << outputFile.lastError() << std::endl;
+        return 1;
     }
 
-    RBTNode *minimum(RBTNode *node)
+    WriteAheadLog wal(walBytes, walWindowMicros);
+    if (!walFileName.empty())
     {
-        while (node->left)
+        // Replayed like the commands themselves, minus their output; Inserts are applied one at a
+        // time so a rejected record fails the open right where it is
+        OutputWriter discard;
+        discard.open("/dev/null");
+        CommandExecutor replay(*rides, discard, false);
+        std::uint64_t replayed = 0;
+        if (!wal.open(walFileName, [&](const Command &command) { return replay.execute(command); }, replayed))
         {
-            node = node->left;
+            std::cout << "Error opening write-ahead log: " << walFileName << ": " << wal.lastError() << std::endl;
+            return 1;
         }
-        return node;
+        replay.finish();
     }
 
-    void removeFixup(RBTNode *node)
+    CommandExecutor executor(*rides, outputFile);
+    if (wal.isOpen())
     {
-        while (node && node != root && node->color == BLACK)
-        {
-            if (node == node->parent->left)
-            {
-                RBTNode *sibling = node->parent->right;
-
-                // If sibling is red, recolor sibling and parent of node
-                if (sibling && sibling->color == RED)
-                {
-                    sibling->color = BLACK;
-                    node->parent->color = RED;
-                    leftRotate(node->parent);
-                    sibling = node->parent->right;
-                }
+        executor.wal = &wal;
+    }
+    RangeCache rangeCache(rangeCacheSize);
+    if (rangeCache.isEnabled())
+    {
+        executor.rangeCache = &rangeCache;
+    }
+    ParallelRangePrinter parallelPrinter(static_cast<unsigned>(printThreads), printParallelMin);
+    if (printThreads != 1)
+    {
+        executor.parallelPrinter = &parallelPrinter;
+    }
 
-                // If sibling is black and both children of sibling are black, recolor sibling
-                if ((!sibling->left || sibling->left->color == BLACK) && (!sibling->right || sibling->right->color == BLACK))
-                {
-                    sibling->color = RED;
-                    node = node->parent;
-                } // If sibling is black and left child of sibling is red and right child of sibling is black, recolor sibling and left child of sibling
-                else
-                {
-                    // If right child of sibling is black, recolor sibling and left child of sibling
-                    if (!sibling->right || sibling->right->color == BLACK)
-                    {
-                        sibling->left->color = BLACK;
-                        sibling->color = RED;
-                        rightRotate(sibling);
-                        sibling = node->parent->right;
-                    }
-                    sibling->color = node->parent->color;
-                    node->parent->color = BLACK;
-
-                    // If right child of sibling is red, recolor right child of sibling
-                    if (sibling->right)
-                        sibling->right->color = BLACK;
-
-                    // Rotate left at parent of node
-                    leftRotate(node->parent);
-                    node = root;
-                }
-            }
-            else
-            {
-                RBTNode *sibling = node->parent->left;
-                if (sibling && sibling->color == RED)
-                {
-                    sibling->color = BLACK;
-                    node->parent->color = RED;
-                    rightRotate(node->parent);
-                    sibling = node->parent->left;
-                }
-                if ((!sibling->right || sibling->right->color == BLACK) && (!sibling->left || sibling->left->color == BLACK))
-                {
-                    sibling->color = RED;
-                    node = node->parent;
-                }
-                else
-                {
-                    if (!sibling->left || sibling->left->color == BLACK)
-                    {
-                        sibling->right->color = BLACK;
-                        sibling->color = RED;
-                        leftRotate(sibling);
-                        sibling = node->parent->left;
-                    }
-                    sibling->color = node->parent->color;
-                    node->parent->color = BLACK;
-                    if (sibling->left)
-                        sibling->left->color = BLACK;
-                    rightRotate(node->parent);
-                    node = root;
-                }
-            }
-        }
-        if (node)
-            node->color = BLACK;
+    if (snapshotFileName.empty())
+    {
+        snapshotFileName = "gatorTaxi.snapshot";
+    }
+    else
+    {
+        Snapshot::installSignalHandler();
     }
+    // Call only once every command up to inputOffset has been applied
+    auto takeSnapshot = [&](std::uint64_t inputOffset, long line)
+    {
+        // The output up to here must reach the file for the recorded offset to be there on restore
+        outputFile.flush();
+        Snapshot::Position position = {inputOffset, static_cast<std::uint64_t>(line), outputFile.position()};
+        std::string error;
+        if (!Snapshot::write(snapshotFileName, *rides, position, error))
+        {
+            std::cerr << "Error writing snapshot " << snapshotFileName << ": " << error << std::endl;
+        }
+    };
 
-    void deleteTree(RBTNode *node)
+#ifdef GATORTAXI_STATS
+    RuntimeStats stats;
+    executor.stats = &stats;
+    RuntimeStats::installSignalHandler();
+    auto dumpStats = [&]()
     {
-        if (!node)
+        std::FILE *out = statsFileName == "-" ? stderr : std::fopen(statsFileName.c_str(), "w");
+        if (!out)
         {
+            std::cerr << "Error opening stats file: " << statsFileName << std::endl;
             return;
         }
+        stats.dump(out, rides->size(), rides->height(), rides->insertRotations, rides->removeRotations);
+        if (rangeCache.isEnabled())
+            rangeCache.dumpCounters(out);
+        if (out != stderr)
+            std::fclose(out);
+    };
+#endif
 
-        deleteTree(node->left);
-        deleteTree(node->right);
-        delete node;
-    }
-
-    bool printRangeHelper(RBTNode *node, int rideNumber1, int rideNumber2, std::ofstream &outputFile, bool &printed)
+    // Applies one parsed command that ends at inputOffset; false once the run has to stop
+    auto process = [&](const Command &command, std::uint64_t inputOffset, long line) -> bool
     {
-        if (!node)
+        if (!executor.execute(command))
         {
             return false;
         }
-
-        bool foundInRange = false;
-        if (rideNumber1 < node->ride.rideNumber)
+        if (command.type == CMD_SNAPSHOT)
         {
-            foundInRange |= printRangeHelper(node->left, rideNumber1, rideNumber2, outputFile, printed);
+            takeSnapshot(inputOffset, line);
         }
-        if (rideNumber1 <= node->ride.rideNumber && node->ride.rideNumber <= rideNumber2)
+        else if (Snapshot::requested())
         {
-            if (printed)
+            Snapshot::requested() = 0;
+            if (executor.finish())
             {
-                outputFile << ",";
+                takeSnapshot(inputOffset, line);
             }
-            printed = true;
-            foundInRange = true;
-            outputFile << node->ride.toString();
         }
-        if (node->ride.rideNumber < rideNumber2)
+
+#ifdef GATORTAXI_STATS
+        if (RuntimeStats::dumpRequested())
         {
-            foundInRange |= printRangeHelper(node->right, rideNumber1, rideNumber2, outputFile, printed);
+            RuntimeStats::dumpRequested() = 0;
+            dumpStats();
         }
-        return foundInRange;
-    }
-};
+#endif
+        return true;
+    };
+    auto processItem = [&](const PipelineItem &item) { return process(item.command, item.inputOffset, item.lineNumber); };
+    // Nothing is queued behind the last command, so its response goes out now, once the
+    // mutations it acknowledges are on disk; false if the run has to stop (a duplicate among the
+    // held-back Inserts, or a failed log)
+    auto idle = [&]() -> bool
+    {
+        bool running = executor.finish();
+        if (wal.isOpen() && !wal.commit())
+        {
+            return false;
+        }
+        outputFile.flush();
+        return running;
+    };
 
-// Main function
-int main(int argc, char *argv[])
-{
-    if (argc != 2)
+    int exitCode = 0;
+    if (!listenPath.empty())
     {
-        std::cout << "Usage: " << argv[0] << " file_name" << std::endl;
-        return 1;
+        exitCode = listen(listenPath, inputFile, outputFile, [&](InputSource &connection)
+                          { return CommandPipeline::run(connection, listenPath, 0, processItem, idle); });
     }
-
-    std::string fileName = argv[1];
-    std::ifstream inputFile(fileName);
-    std::ofstream outputFile("output_file.txt");
-
-    if (!inputFile.is_open())
+    else if (serve)
     {
-        std::cout << "Error opening file: " << fileName << std::endl;
-        return 1;
+        CommandPipeline::run(inputFile, fileName, lineNumber, processItem, idle);
     }
-
-    RBTree rbt;
-
-    std::string line;
-
-    while (std::getline(inputFile, line))
+    else
     {
-        std::istringstream iss(line);
-        std::string operation;
-        std::getline(iss, operation, '(');
-
-        if (operation == "Insert")
-        {
-            int rideNumber, rideCost, tripDuration;
-            char discard;
-            iss >> rideNumber >> discard >> rideCost >> discard >> tripDuration >> discard;
-            Ride ride(rideNumber, rideCost, tripDuration);
-
-            if (rbt.search(rideNumber))
-            {
-                outputFile << "Duplicate RideNumber";
-                break;
-            }
+        const char *lineBegin;
+        const char *lineEnd;
+        Command command;
+        const char *error = nullptr;
 
-            rbt.insert(ride);
-        }
-        else if (operation == "Print")
+        while (inputFile.nextLine(lineBegin, lineEnd))
         {
-            int rideNumber1, rideNumber2;
-            char discard2;
-            std::string restOfLine;
-            iss >> rideNumber1 >> restOfLine;
-            std::istringstream restOfLineStream(restOfLine);
-            if (restOfLineStream >> discard2 && discard2 == ',')
+            ++lineNumber;
+            ParseResult result = CommandParser::parse(lineBegin, lineEnd, command, error);
+            if (result == PARSE_EMPTY)
             {
-                restOfLineStream >> rideNumber2;
-                rbt.printRange(rideNumber1, rideNumber2, outputFile);
-                outputFile << std::endl;
+                continue;
             }
-            else
+            if (result == PARSE_ERROR)
             {
-                rbt.printRange(rideNumber1, outputFile);
+                std::cerr << fileName << ":" << lineNumber << ": " << error << ": " << std::string(lineBegin, lineEnd) << std::endl;
+                continue;
             }
-        }
-        else if (operation == "UpdateTrip")
-        {
-            int rideNumber, newTripDuration;
-            char discard;
-            iss >> rideNumber >> discard >> newTripDuration >> discard;
-            rbt.updateTrip(rideNumber, newTripDuration);
-        }
-        else if (operation == "GetNextRide")
-        {
-            if (rbt.minHeap->isEmpty())
-            {
-                outputFile << "No active ride requests" << std::endl;
-            }
-            else
-            {
-                Ride nextRide = rbt.minHeap->extractMin();
-                rbt.remove(nextRide);
-                outputFile << "(" << nextRide.rideNumber << "," << nextRide.rideCost << "," << nextRide.tripDuration << ")" << std::endl;
-            }
-        }
-        else if (operation == "CancelRide")
-        {
-            int rideNumber;
-            char discard;
-            iss >> rideNumber >> discard;
 
-            RBTNode *node = rbt.search(rideNumber);
-            if (node)
+            if (!process(command, inputFile.position(), lineNumber))
             {
-
-                rbt.remove(node->ride);
+                break;
             }
         }
     }
+    executor.finish();
+#ifdef GATORTAXI_STATS
+    dumpStats();
+#endif
+
+    if (!inputFile.lastError().empty())
+    {
+        std::cerr << "Error reading " << fileName << ": " << inputFile.lastError() << std::endl;
+    }
 
     inputFile.close();
     outputFile.close();
+    wal.close();
+    if (!wal.lastError().empty())
+    {
+        std::cerr << "Error writing " << walFileName << ": " << wal.lastError() << std::endl;
+        return 1;
+    }
+    if (!outputFile.lastError().empty())
+    {
+        std::cerr << "Error writing " << outputFileName << ": " << outputFile.lastError() << std::endl;
+        return 1;
+    }
 
-    return 0;
+    return exitCode;
 }